@@ -0,0 +1,106 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation functions with malloc-backed ones that
+// count calls and bytes. A program may replace them only once, so include
+// this from the benchmark's main file and nowhere else.
+namespace allocation_counter {
+
+inline std::atomic<std::size_t> allocations{0};
+inline std::atomic<std::size_t> bytes{0};
+
+inline void *allocate(std::size_t size, std::size_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    size = size == 0 ? 1 : size;
+    void *memory = align <= alignof(std::max_align_t)
+        ? std::malloc(size)
+        : std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+} // namespace allocation_counter
+
+void *operator new(std::size_t size) {
+    return allocation_counter::allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new[](std::size_t size) {
+    return allocation_counter::allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new(std::size_t size, std::align_val_t align) {
+    return allocation_counter::allocate(size, static_cast<std::size_t>(align));
+}
+
+void *operator new[](std::size_t size, std::align_val_t align) {
+    return allocation_counter::allocate(size, static_cast<std::size_t>(align));
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept {
+    std::free(memory);
+}
+
+// Reports the allocations made while it is alive as the "allocs" and
+// "alloc_bytes" counters, averaged per iteration. Create it after the
+// benchmark's setup, right before the timed loop.
+class AllocationScope {
+public:
+    explicit AllocationScope(benchmark::State &state)
+        : state(state),
+          allocations(allocation_counter::allocations.load(std::memory_order_relaxed)),
+          bytes(allocation_counter::bytes.load(std::memory_order_relaxed)) {
+    }
+
+    AllocationScope(const AllocationScope &) = delete;
+    AllocationScope &operator=(const AllocationScope &) = delete;
+
+    ~AllocationScope() {
+        auto made = static_cast<double>(allocation_counter::allocations.load(std::memory_order_relaxed) - allocations);
+        auto size = static_cast<double>(allocation_counter::bytes.load(std::memory_order_relaxed) - bytes);
+        state.counters["allocs"] = benchmark::Counter(made, benchmark::Counter::kAvgIterations);
+        state.counters["alloc_bytes"] = benchmark::Counter(size, benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    benchmark::State &state;
+    std::size_t allocations;
+    std::size_t bytes;
+};
@@ -0,0 +1,182 @@
+#include "polka.cpp"
+
+#include "benchmark_support/allocation_counter.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+// Sources are built from 4-token blocks so every size is a well-formed
+// program. Const-heavy programs fold down to a single constant; input-heavy
+// ones keep every instruction.
+static std::string make_source(std::size_t tokens, bool const_heavy) {
+    static const char *const_blocks[] = {"3 + 1 -", "2 % 5 +", "7 - abs", "4 + 2 -"};
+    static const char *input_blocks[] = {"input + 1 -", "input - abs", "input 3 % +", "dup 2 % -"};
+
+    std::mt19937 gen(42);
+    std::string source = const_heavy ? "1" : "input";
+    for (std::size_t n = 1; n + 4 <= tokens; n += 4) {
+        source += ' ';
+        source += (const_heavy ? const_blocks : input_blocks)[gen() % 4];
+    }
+    return source;
+}
+
+// One-argument program whose values stay small for any length.
+static std::string make_stack_source(std::size_t tokens) {
+    std::string source;
+    for (std::size_t n = 0; n + 4 <= tokens; n += 4) {
+        source += "dup 3 % + abs ";
+    }
+    return source;
+}
+
+// Lowers source text without running the optimizer.
+static std::shared_ptr<Program> lex_program(std::string_view source) {
+    std::vector<Instruction> code;
+    Lexer lexer(source);
+    std::string_view token;
+    while (lexer.next(token)) {
+        if (is_number(token)) {
+            code.push_back({OpCode::Const, parse_number(token)});
+        } else if (auto op = parse_operator(token)) {
+            code.push_back({*op});
+        }
+    }
+    return std::make_shared<Program>(std::move(code));
+}
+
+static void set_token_rate(benchmark::State &state, std::size_t tokens) {
+    state.counters["tokens/s"] = benchmark::Counter(static_cast<double>(tokens * state.iterations()),
+        benchmark::Counter::kIsRate);
+}
+
+static void set_eval_rate(benchmark::State &state, std::size_t evaluations) {
+    state.counters["evals/s"] = benchmark::Counter(static_cast<double>(evaluations * state.iterations()),
+        benchmark::Counter::kIsRate);
+}
+
+static void BM_Lex(benchmark::State &state) {
+    std::string source = make_source(state.range(0), false);
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        Lexer lexer(source);
+        std::string_view token;
+        std::size_t count = 0;
+        while (lexer.next(token)) {
+            ++count;
+        }
+        benchmark::DoNotOptimize(count);
+    }
+    set_token_rate(state, state.range(0));
+}
+BENCHMARK(BM_Lex)->RangeMultiplier(10)->Range(10, 1000000);
+
+static void BM_CompileConstHeavy(benchmark::State &state) {
+    std::string source = make_source(state.range(0), true);
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(compile(source));
+    }
+    set_token_rate(state, state.range(0));
+}
+BENCHMARK(BM_CompileConstHeavy)->RangeMultiplier(10)->Range(10, 1000000);
+
+static void BM_CompileInputHeavy(benchmark::State &state) {
+    std::string source = make_source(state.range(0), false);
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(compile(source));
+    }
+    set_token_rate(state, state.range(0));
+}
+BENCHMARK(BM_CompileInputHeavy)->RangeMultiplier(10)->Range(10, 1000000);
+
+static void BM_OptimizeConstHeavy(benchmark::State &state) {
+    std::shared_ptr<Statement> program = lex_program(make_source(state.range(0), true));
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(optimize(program));
+    }
+    set_token_rate(state, state.range(0));
+}
+BENCHMARK(BM_OptimizeConstHeavy)->RangeMultiplier(10)->Range(10, 1000000);
+
+static void BM_OptimizeInputHeavy(benchmark::State &state) {
+    std::shared_ptr<Statement> program = lex_program(make_source(state.range(0), false));
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(optimize(program));
+    }
+    set_token_rate(state, state.range(0));
+}
+BENCHMARK(BM_OptimizeInputHeavy)->RangeMultiplier(10)->Range(10, 1000000);
+
+static void BM_ApplyProgram(benchmark::State &state) {
+    std::shared_ptr<Statement> program = compile(make_stack_source(state.range(0)));
+    std::vector<int> stack;
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        stack.assign(1, 5);
+        program->apply_inplace(stack);
+        benchmark::DoNotOptimize(stack.data());
+    }
+    set_token_rate(state, state.range(0));
+    set_eval_rate(state, 1);
+}
+BENCHMARK(BM_ApplyProgram)->RangeMultiplier(10)->Range(10, 1000000);
+
+// Same workload through a hand-built Combine chain. Capped at 100k tokens,
+// since Combine::apply recurses once per node.
+static void BM_ApplyCombine(benchmark::State &state) {
+    std::shared_ptr<Statement> chain = std::make_shared<BlankStr>();
+    for (long n = 0; n + 4 <= state.range(0); n += 4) {
+        chain = chain | std::make_shared<Dup>() | std::make_shared<ConstOp>(3) | std::make_shared<Modulus>() |
+            std::make_shared<Plus>() | std::make_shared<Abs>();
+    }
+    std::vector<int> stack;
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        stack.assign(1, 5);
+        chain->apply_inplace(stack);
+        benchmark::DoNotOptimize(stack.data());
+    }
+    set_token_rate(state, state.range(0));
+    set_eval_rate(state, 1);
+}
+BENCHMARK(BM_ApplyCombine)->RangeMultiplier(10)->Range(10, 100000);
+
+static void BM_ApplyBatch(benchmark::State &state) {
+    auto program = std::dynamic_pointer_cast<Program>(compile(make_stack_source(1000)));
+    std::size_t lanes = state.range(0);
+    std::vector<std::vector<int>> stack;
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        stack.assign(1, std::vector<int>(lanes, 5));
+        program->apply_batch_inplace(stack, lanes, {});
+        benchmark::DoNotOptimize(stack.data());
+    }
+    set_token_rate(state, 1000 * lanes);
+    set_eval_rate(state, lanes);
+}
+BENCHMARK(BM_ApplyBatch)->RangeMultiplier(8)->Range(1, 32768);
+
+// The same lanes evaluated one apply_inplace call at a time, for comparison.
+static void BM_ApplySingleLanes(benchmark::State &state) {
+    auto program = compile(make_stack_source(1000));
+    std::size_t lanes = state.range(0);
+    std::vector<int> stack;
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < lanes; ++i) {
+            stack.assign(1, 5);
+            program->apply_inplace(stack);
+            benchmark::DoNotOptimize(stack.data());
+        }
+    }
+    set_token_rate(state, 1000 * lanes);
+    set_eval_rate(state, lanes);
+}
+BENCHMARK(BM_ApplySingleLanes)->RangeMultiplier(8)->Range(1, 32768);
+
+BENCHMARK_MAIN();
@@ -6,9 +6,64 @@
 #include <memory>
 #include <functional>
 #include <ranges>
-#include <unordered_map>
-#include <regex>
 #include <algorithm>
+#include <type_traits>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <optional>
+#include <charconv>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <array>
+#include <utility>
+
+
+enum class OpCode : unsigned char {
+    Const, Add, Sub, Div, Mul, Mod, Abs, Dup, Input, Call
+};
+
+// One bytecode instruction. `value` is the literal for Const and the index
+// into Program's call table for Call; other opcodes ignore it.
+struct Instruction {
+    OpCode op;
+    int value = 0;
+};
+
+// Stack effect of a statement: how many values it takes from the stack, how
+// many it leaves there, whether it is free of side effects, and the peak
+// stack height it reaches when started with exactly `arguments` values.
+struct Signature {
+    unsigned arguments;
+    unsigned results;
+    bool pure;
+    unsigned max_depth;
+};
+
+// Stack effect of running `l` and then `r`.
+constexpr Signature combine_signatures(Signature l, Signature r) {
+    unsigned missing = r.arguments > l.results ? r.arguments - l.results : 0;
+    unsigned unused = l.results > r.arguments ? l.results - r.arguments : 0;
+    unsigned depth = std::max(missing + l.max_depth, unused + r.max_depth);
+    return {l.arguments + missing, r.results + unused, l.pure && r.pure, depth};
+}
+
+// Stack effect of every opcode except Call, whose effect is its target's.
+constexpr Signature opcode_signature(OpCode op) {
+    switch (op) {
+    case OpCode::Const:
+        return {0, 1, true, 1};
+    case OpCode::Abs:
+        return {1, 1, true, 1};
+    case OpCode::Dup:
+        return {1, 2, true, 2};
+    case OpCode::Input:
+        return {0, 1, false, 1};
+    default:
+        return {2, 1, true, 2};
+    }
+}
 
 
 class Combine: public Statement {
@@ -16,11 +71,13 @@ public:
     Combine() = default;
     Combine(const Combine &c) = default;
     Combine(const std::shared_ptr<Statement>& l, const std::shared_ptr<Statement>& r)
-        : Statement(calculateArgumentsCount(l, r), calculateResultsCount(l, r), calculateIsPure(l, r)), l(l), r(r) {}    
+        : Statement(calculateArgumentsCount(l, r), calculateResultsCount(l, r), calculateIsPure(l, r),
+              calculateMaxStackDepth(l, r)), l(l), r(r) {}
     
-    std::vector<int> apply(std::vector<int> in) const override{ 
-        return r->apply(l->apply(in)); 
-    } 
+    void apply_inplace(std::vector<int> &stack) const override {
+        l->apply_inplace(stack);
+        r->apply_inplace(stack);
+    }
     inline std::shared_ptr<Statement> get_l() const {
         return l;
     }
@@ -30,16 +87,26 @@ public:
 
 private:
     std::shared_ptr<Statement> l, r;
+    static Signature calculateSignature(const std::shared_ptr<Statement>& l, const std::shared_ptr<Statement>& r) {
+        return combine_signatures(
+            {l->get_arguments_count(), l->get_results_count(), l->is_pure(), l->get_max_stack_depth()},
+            {r->get_arguments_count(), r->get_results_count(), r->is_pure(), r->get_max_stack_depth()});
+    }
+
     static unsigned calculateArgumentsCount(const std::shared_ptr<Statement>& l, const std::shared_ptr<Statement>& r) {
-        return l->get_arguments_count() + std::max(static_cast<int>(r->get_arguments_count()) - static_cast<int>(l->get_results_count()), 0);
+        return calculateSignature(l, r).arguments;
     }
 
     static unsigned calculateResultsCount(const std::shared_ptr<Statement>& l, const std::shared_ptr<Statement>& r) {
-        return r->get_results_count() + std::max(static_cast<int>(l->get_results_count()) - static_cast<int>(r->get_arguments_count()), 0);
+        return calculateSignature(l, r).results;
     }
 
     static bool calculateIsPure(const std::shared_ptr<Statement>& l, const std::shared_ptr<Statement>& r) {
-        return l->is_pure() && r->is_pure();
+        return calculateSignature(l, r).pure;
+    }
+
+    static unsigned calculateMaxStackDepth(const std::shared_ptr<Statement>& l, const std::shared_ptr<Statement>& r) {
+        return calculateSignature(l, r).max_depth;
     }
 
 };
@@ -49,9 +116,12 @@ public:
     ConstOp(int v) : Statement(0, 1, true), v(v) {
     }
 
-    inline std::vector<int> apply(std::vector<int> in) const override {
-        in.push_back(v);
-        return in;
+    inline int get_value() const {
+        return v;
+    }
+
+    inline void apply_inplace(std::vector<int> &stack) const override {
+        stack.push_back(v);
     }
 
 private:
@@ -59,19 +129,36 @@ private:
 };
 
 
+template<auto func>
+constexpr OpCode binary_opcode() {
+    using F = std::remove_cvref_t<decltype(func)>;
+    if constexpr (std::is_same_v<F, std::plus<>>) {
+        return OpCode::Add;
+    } else if constexpr (std::is_same_v<F, std::minus<>>) {
+        return OpCode::Sub;
+    } else if constexpr (std::is_same_v<F, std::divides<>>) {
+        return OpCode::Div;
+    } else if constexpr (std::is_same_v<F, std::multiplies<>>) {
+        return OpCode::Mul;
+    } else if constexpr (std::is_same_v<F, std::modulus<>>) {
+        return OpCode::Mod;
+    } else {
+        return OpCode::Call;
+    }
+}
+
 template<auto func>
 class BinaryOP: public Statement {
 public:
-    BinaryOP() : Statement(2, 1, true) {}
+    static constexpr OpCode opcode = binary_opcode<func>();
 
-    inline std::vector<int> apply(std::vector<int> in) const override {
-        int b = in.back();
-        in.pop_back();
-        int a = in.back();
-        in.pop_back();
-        in.push_back(func(a, b));
+    BinaryOP() : Statement(2, 1, true) {}
 
-        return in;
+    inline void apply_inplace(std::vector<int> &stack) const override {
+        int b = stack.back();
+        stack.pop_back();
+        int &a = stack.back();
+        a = func(a, b);
     }
 };
 
@@ -79,24 +166,90 @@ class Abs : public Statement {
 public:
     Abs() : Statement(1, 1, true) {}
 
-    inline std::vector<int> apply(std::vector<int> in) const override {
-        int b = in.back();
-        in.pop_back();
-        in.push_back(std::abs(b));
-        return in;
+    inline void apply_inplace(std::vector<int> &stack) const override {
+        int &b = stack.back();
+        b = std::abs(b);
+    }
+
+};
+
+// Where Input takes its values from. Every thread has its own current
+// source, std::cin unless another one is installed with ScopedInputSource.
+class InputSource {
+public:
+    virtual int read() = 0;
+
+    virtual ~InputSource() = default;
+};
+
+class StreamInputSource : public InputSource {
+public:
+    explicit StreamInputSource(std::istream &stream) : stream(stream) {}
+
+    int read() override {
+        int value;
+        stream >> value;
+        return value;
+    }
+
+private:
+    std::istream &stream;
+};
+
+class VectorInputSource : public InputSource {
+public:
+    explicit VectorInputSource(std::vector<int> values) : values(std::move(values)) {}
+
+    int read() override {
+        if (next == values.size()) {
+            throw std::invalid_argument("Input source is exhausted\n");
+        }
+        return values[next++];
+    }
+
+private:
+    std::vector<int> values;
+    std::size_t next = 0;
+};
+
+inline InputSource *&current_input_source() {
+    thread_local InputSource *source = nullptr;
+    return source;
+}
+
+inline int read_input() {
+    if (InputSource *source = current_input_source()) {
+        return source->read();
+    }
+    int value;
+    std::cin >> value;
+    return value;
+}
+
+// Installs `source` as the calling thread's input for the guard's lifetime.
+class ScopedInputSource {
+public:
+    explicit ScopedInputSource(InputSource &source) : previous(current_input_source()) {
+        current_input_source() = &source;
+    }
+
+    ScopedInputSource(const ScopedInputSource &) = delete;
+    ScopedInputSource &operator=(const ScopedInputSource &) = delete;
+
+    ~ScopedInputSource() {
+        current_input_source() = previous;
     }
 
+private:
+    InputSource *previous;
 };
 
 class Input : public Statement {
 public:
     Input() : Statement(0, 1, false) {}
 
-    inline std::vector<int> apply(std::vector<int> in) const override {
-        int value;
-        std::cin >> value;
-        in.push_back(value);
-        return in;
+    inline void apply_inplace(std::vector<int> &stack) const override {
+        stack.push_back(read_input());
     }
 };
 
@@ -104,10 +257,9 @@ class Dup : public Statement {
 public:
     Dup() : Statement(1, 2, true) {}
 
-    inline std::vector<int> apply(std::vector<int> in) const override {
-        int a = in.back();
-        in.push_back(a);
-        return in;
+    inline void apply_inplace(std::vector<int> &stack) const override {
+        int a = stack.back();
+        stack.push_back(a);
     }
 };
 
@@ -115,8 +267,7 @@ class BlankStr : public Statement {
 public:
     BlankStr() : Statement(0, 0, true) {}
 
-    inline std::vector<int> apply(std::vector<int> in) const override {
-        return in;
+    inline void apply_inplace(std::vector<int> &) const override {
     }
 };
 
@@ -126,67 +277,782 @@ std::shared_ptr<Statement> operator|(std::shared_ptr<Statement> lhs, std::shared
 }
 
 
+inline Signature instruction_signature(const Instruction &ins, const std::vector<std::shared_ptr<Statement>> &calls) {
+    if (ins.op == OpCode::Call) {
+        const Statement &stmt = *calls[ins.value];
+        return {stmt.get_arguments_count(), stmt.get_results_count(), stmt.is_pure(), stmt.get_max_stack_depth()};
+    }
+    return opcode_signature(ins.op);
+}
+
+using Plus = BinaryOP<std::plus<>{}>;
+using Minus = BinaryOP<std::minus<>{}>;
+using Divides = BinaryOP<std::divides<>{}>;
+using Multiplies = BinaryOP<std::multiplies<>{}>;
+using Modulus = BinaryOP<std::modulus<>{}>;
+
+// A whole program lowered into a flat instruction array, executed by a
+// single dispatch loop instead of a chain of virtual Combine calls.
+class Program: public Statement {
+public:
+    Program(std::vector<Instruction> code, std::vector<std::shared_ptr<Statement>> calls = {})
+        : Statement(0, 0, true), code(std::move(code)), calls(std::move(calls)) {
+        Signature total{0, 0, true, 0};
+        for (const Instruction &ins : this->code) {
+            total = combine_signatures(total, signature(ins));
+        }
+        arguments = total.arguments;
+        results = total.results;
+        pure = total.pure;
+        max_depth = total.max_depth;
+    }
+
+    // The stack is grown once to the program's static peak depth, so the
+    // dispatch loop works on a raw pointer and never reallocates.
+    void apply_inplace(std::vector<int> &stack) const override {
+        if (stack.size() < arguments) {
+            throw std::invalid_argument("Not enough values on the stack\n");
+        }
+        std::size_t peak = stack.size() - arguments + max_depth;
+        std::size_t size = stack.size();
+        stack.resize(peak);
+        int *data = stack.data();
+        int *top = data + size;
+
+        for (const Instruction &ins : code) {
+            switch (ins.op) {
+            case OpCode::Const:
+                *top++ = ins.value;
+                break;
+            case OpCode::Add:
+                top = binary(top, std::plus<>{});
+                break;
+            case OpCode::Sub:
+                top = binary(top, std::minus<>{});
+                break;
+            case OpCode::Div:
+                top = binary(top, std::divides<>{});
+                break;
+            case OpCode::Mul:
+                top = binary(top, std::multiplies<>{});
+                break;
+            case OpCode::Mod:
+                top = binary(top, std::modulus<>{});
+                break;
+            case OpCode::Abs:
+                top[-1] = std::abs(top[-1]);
+                break;
+            case OpCode::Dup:
+                *top = top[-1];
+                ++top;
+                break;
+            case OpCode::Input:
+                *top++ = read_input();
+                break;
+            case OpCode::Call:
+                // Shrinking and regrowing stays within the reserved peak.
+                stack.resize(top - data);
+                calls[ins.value]->apply_inplace(stack);
+                size = stack.size();
+                stack.resize(peak);
+                data = stack.data();
+                top = data + size;
+                break;
+            }
+        }
+        stack.resize(top - data);
+    }
+
+    // Runs the program over `lanes` independent stacks at once. The batch is
+    // column-major: stack[i] holds slot i of every lane, and each Input
+    // instruction takes the next column of `inputs` instead of reading
+    // std::cin. Every instruction is one loop over whole columns.
+    void apply_batch_inplace(std::vector<std::vector<int>> &stack, std::size_t lanes,
+        const std::vector<std::vector<int>> &inputs) const {
+        if (stack.size() < arguments) {
+            throw std::invalid_argument("Not enough values on the stack\n");
+        }
+        for (std::size_t i = stack.size() - arguments; i < stack.size(); ++i) {
+            if (stack[i].size() < lanes) {
+                throw std::invalid_argument("Stack column shorter than the batch\n");
+            }
+        }
+        std::size_t top = stack.size();
+        std::size_t next_input = 0;
+        stack.reserve(top + max_depth);
+
+        auto push = [&]() -> int * {
+            if (top == stack.size()) {
+                stack.emplace_back(lanes);
+            } else {
+                stack[top].resize(lanes);
+            }
+            return stack[top++].data();
+        };
+
+        for (const Instruction &ins : code) {
+            switch (ins.op) {
+            case OpCode::Const:
+                std::fill_n(push(), lanes, ins.value);
+                break;
+            case OpCode::Add:
+                batch_binary(stack, top, lanes, std::plus<>{});
+                break;
+            case OpCode::Sub:
+                batch_binary(stack, top, lanes, std::minus<>{});
+                break;
+            case OpCode::Div:
+                batch_binary(stack, top, lanes, std::divides<>{});
+                break;
+            case OpCode::Mul:
+                batch_binary(stack, top, lanes, std::multiplies<>{});
+                break;
+            case OpCode::Mod:
+                batch_binary(stack, top, lanes, std::modulus<>{});
+                break;
+            case OpCode::Abs: {
+                int *a = stack[top - 1].data();
+                for (std::size_t i = 0; i < lanes; ++i) {
+                    a[i] = std::abs(a[i]);
+                }
+                break;
+            }
+            case OpCode::Dup: {
+                const int *a = stack[top - 1].data();
+                std::copy_n(a, lanes, push());
+                break;
+            }
+            case OpCode::Input: {
+                if (next_input == inputs.size() || inputs[next_input].size() < lanes) {
+                    throw std::invalid_argument("Not enough input columns for batch\n");
+                }
+                std::copy_n(inputs[next_input++].data(), lanes, push());
+                break;
+            }
+            case OpCode::Call:
+                batch_call(*calls[ins.value], stack, top, lanes);
+                break;
+            }
+        }
+        stack.resize(top);
+    }
+
+    std::vector<std::vector<int>> apply_batch(std::vector<std::vector<int>> in, std::size_t lanes,
+        const std::vector<std::vector<int>> &inputs = {}) const {
+        apply_batch_inplace(in, lanes, inputs);
+        return in;
+    }
+
+    inline const std::vector<Instruction> &get_code() const {
+        return code;
+    }
+
+    inline const std::vector<std::shared_ptr<Statement>> &get_calls() const {
+        return calls;
+    }
+
+    // Stack effect of a single instruction, as Statement would report it.
+    Signature signature(const Instruction &ins) const {
+        return instruction_signature(ins, calls);
+    }
+
+private:
+    std::vector<Instruction> code;
+    std::vector<std::shared_ptr<Statement>> calls;
+
+    template<class F>
+    static inline void batch_binary(std::vector<std::vector<int>> &stack, std::size_t &top, std::size_t lanes, F func) {
+        int *a = stack[top - 2].data();
+        const int *b = stack[top - 1].data();
+        for (std::size_t i = 0; i < lanes; ++i) {
+            a[i] = func(a[i], b[i]);
+        }
+        --top;
+    }
+
+    // Statements without an opcode run lane by lane on a scratch stack.
+    static void batch_call(const Statement &stmt, std::vector<std::vector<int>> &stack, std::size_t &top,
+        std::size_t lanes) {
+        std::size_t args = stmt.get_arguments_count();
+        std::size_t res = stmt.get_results_count();
+        std::size_t base = top - args;
+        while (stack.size() < base + res) {
+            stack.emplace_back(lanes);
+        }
+        for (std::size_t slot = top; slot < base + res; ++slot) {
+            stack[slot].resize(lanes);
+        }
+
+        std::vector<int> scratch;
+        for (std::size_t i = 0; i < lanes; ++i) {
+            scratch.clear();
+            for (std::size_t slot = base; slot < top; ++slot) {
+                scratch.push_back(stack[slot][i]);
+            }
+            stmt.apply_inplace(scratch);
+            for (std::size_t slot = 0; slot < res; ++slot) {
+                stack[base + slot][i] = scratch[slot];
+            }
+        }
+        top = base + res;
+    }
+
+    template<class F>
+    static inline int *binary(int *top, F func) {
+        top[-2] = func(top[-2], top[-1]);
+        return top - 1;
+    }
+};
+
+
+template<class... Ops>
+static bool lower_binary(const Statement *stmt, std::vector<Instruction> &code) {
+    return ((dynamic_cast<const Ops *>(stmt) && (code.push_back({Ops::opcode}), true)) || ...);
+}
+
+// Flattens an arbitrary Statement tree into a Program. Combine nodes are
+// walked with an explicit stack, so arbitrarily long chains do not recurse.
+// Statements that have no opcode are kept and invoked through OpCode::Call.
+std::shared_ptr<Program> lower(const std::shared_ptr<Statement> &stmt) {
+    if (auto program = std::dynamic_pointer_cast<Program>(stmt)) {
+        return program;
+    }
+
+    std::vector<Instruction> code;
+    std::vector<std::shared_ptr<Statement>> calls;
+    std::vector<std::shared_ptr<Statement>> pending{stmt};
+
+    while (!pending.empty()) {
+        std::shared_ptr<Statement> node = std::move(pending.back());
+        pending.pop_back();
+        const Statement *raw = node.get();
+
+        if (auto combine = dynamic_cast<const Combine *>(raw)) {
+            pending.push_back(combine->get_r());
+            pending.push_back(combine->get_l());
+        } else if (auto program = dynamic_cast<const Program *>(raw)) {
+            int offset = static_cast<int>(calls.size());
+            calls.insert(calls.end(), program->get_calls().begin(), program->get_calls().end());
+            for (Instruction ins : program->get_code()) {
+                if (ins.op == OpCode::Call) {
+                    ins.value += offset;
+                }
+                code.push_back(ins);
+            }
+        } else if (auto const_op = dynamic_cast<const ConstOp *>(raw)) {
+            code.push_back({OpCode::Const, const_op->get_value()});
+        } else if (dynamic_cast<const Abs *>(raw)) {
+            code.push_back({OpCode::Abs});
+        } else if (dynamic_cast<const Dup *>(raw)) {
+            code.push_back({OpCode::Dup});
+        } else if (dynamic_cast<const Input *>(raw)) {
+            code.push_back({OpCode::Input});
+        } else if (dynamic_cast<const BlankStr *>(raw)) {
+        } else if (!lower_binary<Plus, Minus, Divides, Multiplies, Modulus>(raw, code)) {
+            code.push_back({OpCode::Call, static_cast<int>(calls.size())});
+            calls.push_back(std::move(node));
+        }
+    }
+    return std::make_shared<Program>(std::move(code), std::move(calls));
+}
+
+
+
+// Evaluates a pure instruction over constant operands at compile time.
+// Returns false when the result is not representable (overflow, division by
+// zero), so the instruction is left for the runtime to execute.
+static bool fold(const std::vector<std::shared_ptr<Statement>> &calls, const Instruction &ins,
+    std::vector<int> &stack) {
+    if (ins.op == OpCode::Call) {
+        calls[ins.value]->apply_inplace(stack);
+        return true;
+    }
+    if (ins.op == OpCode::Abs) {
+        if (stack.back() == std::numeric_limits<int>::min()) {
+            return false;
+        }
+        stack.back() = std::abs(stack.back());
+        return true;
+    }
+    if (ins.op == OpCode::Dup) {
+        stack.push_back(stack.back());
+        return true;
+    }
+
+    long long b = stack[stack.size() - 1];
+    long long a = stack[stack.size() - 2];
+    long long result;
+    switch (ins.op) {
+    case OpCode::Add:
+        result = a + b;
+        break;
+    case OpCode::Sub:
+        result = a - b;
+        break;
+    case OpCode::Mul:
+        result = a * b;
+        break;
+    case OpCode::Div:
+    case OpCode::Mod:
+        if (b == 0) {
+            return false;
+        }
+        result = ins.op == OpCode::Div ? a / b : a % b;
+        break;
+    default:
+        return false;
+    }
+    if (result < std::numeric_limits<int>::min() || result > std::numeric_limits<int>::max()) {
+        return false;
+    }
+    stack.pop_back();
+    stack.back() = static_cast<int>(result);
+    return true;
+}
+
+// Constant folding and peephole pass over the lowered program.
+//
+// Trailing Const instructions of the output are the statically known top of
+// the stack, so any pure instruction whose operands are all known is replaced
+// by the constants it produces. Identity rewrites (`0 +`, `0 -`, `1 *`,
+// `1 /`, `abs abs`) are only applied when the dropped operand was produced
+// by the program itself, so the argument count of the result never changes.
+static void optimize_code(const std::vector<Instruction> &input, const std::vector<std::shared_ptr<Statement>> &calls,
+    std::vector<Instruction> &code) {
+    code.clear();
+    code.reserve(input.size());
+    thread_local std::vector<int> operands;
+    unsigned known = 0;
+    int depth = 0;
+    int min_depth = 0;
+
+    for (const Instruction &ins : input) {
+        Signature sig = instruction_signature(ins, calls);
+        unsigned args = sig.arguments;
+        unsigned res = sig.results;
+        int lowest = depth - static_cast<int>(args);
+
+        if (ins.op == OpCode::Const) {
+            code.push_back(ins);
+            ++known;
+            ++depth;
+            continue;
+        }
+
+        if (sig.pure && known >= args) {
+            operands.clear();
+            for (auto it = code.end() - args; it != code.end(); ++it) {
+                operands.push_back(it->value);
+            }
+            if (fold(calls, ins, operands)) {
+                code.erase(code.end() - args, code.end());
+                for (int v : operands) {
+                    code.push_back({OpCode::Const, v});
+                }
+                known = known - args + static_cast<unsigned>(operands.size());
+                depth += static_cast<int>(res) - static_cast<int>(args);
+                min_depth = std::min(min_depth, lowest);
+                continue;
+            }
+        }
+
+        const Instruction *last = code.empty() ? nullptr : &code.back();
+        bool operand_is_local = lowest >= min_depth;
+
+        if (last && last->op == OpCode::Const && operand_is_local &&
+            (((ins.op == OpCode::Add || ins.op == OpCode::Sub) && last->value == 0) ||
+             ((ins.op == OpCode::Mul || ins.op == OpCode::Div) && last->value == 1))) {
+            code.pop_back();
+            --known;
+            --depth;
+            continue;
+        }
+        if (last && last->op == OpCode::Abs && ins.op == OpCode::Abs) {
+            continue;
+        }
+        if (last && last->op == OpCode::Dup && ins.op == OpCode::Add) {
+            code.back() = {OpCode::Const, 2};
+            code.push_back({OpCode::Mul});
+            known = 0;
+            --depth;
+            continue;
+        }
+
+        code.push_back(ins);
+        known = 0;
+        depth += static_cast<int>(res) - static_cast<int>(args);
+        min_depth = std::min(min_depth, lowest);
+    }
+}
 
 std::shared_ptr<Statement> optimize(std::shared_ptr<Statement> stmt) {
-    if (auto combine_stmt = dynamic_cast<Combine*>(stmt.get())) {
-        auto left_optimized = optimize(combine_stmt->get_l());
-        auto right_optimized = optimize(combine_stmt->get_r());
+    std::shared_ptr<Program> program = lower(stmt);
+    std::vector<Instruction> code;
+    optimize_code(program->get_code(), program->get_calls(), code);
+    return std::make_shared<Program>(std::move(code), program->get_calls());
+}
+
+
+// Single-pass tokenizer over the source text; tokens are views into it.
+class Lexer {
+public:
+    constexpr explicit Lexer(std::string_view str) : rest(str) {}
 
-        if (right_optimized->get_arguments_count() > left_optimized->get_results_count()) {
-            return stmt; 
+    constexpr bool next(std::string_view &token) {
+        std::size_t begin = 0;
+        while (begin < rest.size() && is_space(rest[begin])) {
+            ++begin;
         }
+        if (begin == rest.size()) {
+            rest = {};
+            return false;
+        }
+        std::size_t end = begin;
+        while (end < rest.size() && !is_space(rest[end])) {
+            ++end;
+        }
+        token = rest.substr(begin, end - begin);
+        rest.remove_prefix(end);
+        return true;
+    }
+
+private:
+    std::string_view rest;
+
+    static constexpr bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+};
 
-        if (auto left_const = dynamic_cast<ConstOp*>(left_optimized.get())) {
-            if (auto right_const = dynamic_cast<ConstOp*>(right_optimized.get())) {
-                std::vector<int> input;
-                input = right_const->apply(left_const->apply(input));
-                return std::make_shared<ConstOp>(input.back());
+// Matches `[-+]?\d+`.
+constexpr bool is_number(std::string_view token) {
+    if (!token.empty() && (token[0] == '-' || token[0] == '+')) {
+        token.remove_prefix(1);
+    }
+    if (token.empty()) {
+        return false;
+    }
+    for (char c : token) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr int parse_number(std::string_view token) {
+    if (token[0] == '+') {
+        token.remove_prefix(1);
+    }
+    if (std::is_constant_evaluated()) {
+        bool negative = token[0] == '-';
+        long long value = 0;
+        for (char c : token.substr(negative ? 1 : 0)) {
+            value = value * 10 + (c - '0');
+            if (value > 1LL + std::numeric_limits<int>::max()) {
+                throw std::out_of_range("Number is out of range");
             }
         }
+        value = negative ? -value : value;
+        if (value > std::numeric_limits<int>::max()) {
+            throw std::out_of_range("Number is out of range");
+        }
+        return static_cast<int>(value);
+    }
+    int value = 0;
+    auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (ec == std::errc::result_out_of_range) {
+        throw std::out_of_range("Number is out of range: " + std::string(token) + "\n");
+    }
+    return value;
+}
 
-        return std::make_shared<Combine>(left_optimized, right_optimized);
+constexpr std::optional<OpCode> parse_operator(std::string_view token) {
+    if (token.size() == 1) {
+        switch (token[0]) {
+        case '+':
+            return OpCode::Add;
+        case '-':
+            return OpCode::Sub;
+        case '/':
+            return OpCode::Div;
+        case '*':
+            return OpCode::Mul;
+        case '%':
+            return OpCode::Mod;
+        }
+    } else if (token == "abs") {
+        return OpCode::Abs;
+    } else if (token == "dup") {
+        return OpCode::Dup;
+    } else if (token == "input") {
+        return OpCode::Input;
     }
-    return stmt;
+    return std::nullopt;
 }
 
 
+// Scratch buffers above this many instructions are released after use
+// rather than kept for the next compile on the thread.
+inline constexpr std::size_t max_scratch_capacity = 1 << 16;
+
 std::shared_ptr<Statement> compile(std::string_view str) {
     if (str.empty() || str.find_first_not_of(" ") == std::string::npos) {
         return std::make_shared<BlankStr>();
     }
 
-    static const std::unordered_map<std::string, std::function<std::shared_ptr<Statement>()>> operator_mapping = {
-        {"+", []() { return std::make_shared<BinaryOP<std::plus<>{}>>(); }},
-        {"-", []() { return std::make_shared<BinaryOP<std::minus<>{}>>(); }},
-        {"/", []() { return std::make_shared<BinaryOP<std::divides<>{}>>(); }},
-        {"*", []() { return std::make_shared<BinaryOP<std::multiplies<>{}>>(); }},
-        {"%", []() { return std::make_shared<BinaryOP<std::modulus<>{}>>(); }},
-        {"abs", []() { return std::make_shared<Abs>(); }},
-        {"input", []() { return std::make_shared<Input>(); }},
-        {"dup", []() { return std::make_shared<Dup>(); }}
-    };
+    // Lexing and optimization run in per-thread scratch buffers that keep
+    // their capacity between calls, so a compile costs exactly two
+    // allocations: the Program with its control block, and its code array.
+    thread_local std::vector<Instruction> lexed;
+    thread_local std::vector<Instruction> optimized;
+    lexed.clear();
+    // Tokens are separated by whitespace, so there are at most half as many
+    // as there are characters, rounded up.
+    lexed.reserve(str.size() / 2 + 1);
 
-    static const std::regex token_regex(R"(\S+)");
-    static const std::regex number_regex(R"([-+]?\d+)");
+    Lexer lexer(str);
+    std::string_view token;
+    while (lexer.next(token)) {
+        if (is_number(token)) {
+            lexed.push_back({OpCode::Const, parse_number(token)});
+        } else if (auto op = parse_operator(token)) {
+            lexed.push_back({*op});
+        }
+    }
+    optimize_code(lexed, {}, optimized);
+    auto program = std::make_shared<Program>(std::vector<Instruction>(optimized.begin(), optimized.end()));
+
+    if (lexed.capacity() > max_scratch_capacity) {
+        lexed = {};
+        optimized = {};
+    }
+    return program;
+}
+
+
+template<std::size_t N>
+struct FixedString {
+    char data[N] {};
+
+    constexpr FixedString(const char (&str)[N]) {
+        std::copy_n(str, N, data);
+    }
 
-    auto tokens_begin = std::regex_iterator<std::string_view::iterator>{str.begin(), str.end(), token_regex};
-    auto tokens_end = std::regex_iterator<std::string_view::iterator>{};
+    constexpr std::string_view view() const {
+        return {data, N - 1};
+    }
+};
 
-    std::shared_ptr<Statement> ret;
-    for (auto it = tokens_begin; it != tokens_end; ++it) {
-        const std::string token = it->str();
+// Parses a program at compile time. Unlike compile(), unknown tokens are an
+// error here, since the source is known to the compiler.
+template<FixedString Source>
+consteval auto parse_static_program() {
+    constexpr std::size_t size = [] {
+        Lexer lexer(Source.view());
+        std::string_view token;
+        std::size_t count = 0;
+        while (lexer.next(token)) {
+            ++count;
+        }
+        return count;
+    }();
 
-        if (std::regex_match(token, number_regex)) {
-            auto const_op = std::make_shared<ConstOp>(std::stoi(token));
-            ret = !ret ? std::move(const_op) : (ret | std::move(const_op));
+    std::array<Instruction, size> code{};
+    Lexer lexer(Source.view());
+    std::string_view token;
+    for (Instruction &ins : code) {
+        lexer.next(token);
+        if (is_number(token)) {
+            ins = {OpCode::Const, parse_number(token)};
+        } else if (auto op = parse_operator(token)) {
+            ins = {*op};
         } else {
-            auto op_it = operator_mapping.find(token);
+            throw std::invalid_argument("Unknown token in static program");
+        }
+    }
+    return code;
+}
 
-            if (op_it != operator_mapping.end()) {
-                auto op_stmt = op_it->second();
-                ret = !ret ? std::move(op_stmt) : (ret | std::move(op_stmt));
-            }
+// A program whose instructions are template arguments. Execution is fully
+// unrolled over a fixed-size local stack, so the compiler can inline and
+// fold the whole program into straight-line code.
+template<auto Code>
+class StaticProgram {
+public:
+    static constexpr Signature signature = [] {
+        Signature total{0, 0, true, 0};
+        for (const Instruction &ins : Code) {
+            total = combine_signatures(total, opcode_signature(ins.op));
         }
+        return total;
+    }();
+
+    static constexpr unsigned arguments = signature.arguments;
+    static constexpr unsigned results = signature.results;
+    static constexpr bool pure = signature.pure;
+    static constexpr unsigned max_stack_depth = signature.max_depth;
+
+    constexpr std::array<int, results> operator()(const std::array<int, arguments> &in) const {
+        std::array<int, max_stack_depth + 1> stack{};
+        std::copy(in.begin(), in.end(), stack.begin());
+        run(stack.data() + arguments, std::make_index_sequence<Code.size()>{});
+
+        std::array<int, results> out{};
+        std::copy_n(stack.begin(), results, out.begin());
+        return out;
+    }
+
+    void operator()(std::vector<int> &stack) const {
+        std::array<int, arguments> in{};
+        if constexpr (arguments > 0) {
+            std::copy(stack.end() - arguments, stack.end(), in.begin());
+        }
+        std::array<int, results> out = (*this)(in);
+        stack.resize(stack.size() - arguments);
+        stack.insert(stack.end(), out.begin(), out.end());
     }
-    return optimize(ret);
+
+    std::vector<int> apply(std::vector<int> in) const {
+        (*this)(in);
+        return in;
+    }
+
+private:
+    template<std::size_t... I>
+    static constexpr void run(int *top, std::index_sequence<I...>) {
+        ((top = step<Code[I]>(top)), ...);
+    }
+
+    template<Instruction ins>
+    static constexpr int *step(int *top) {
+        if constexpr (ins.op == OpCode::Const) {
+            *top = ins.value;
+            return top + 1;
+        } else if constexpr (ins.op == OpCode::Add) {
+            top[-2] = top[-2] + top[-1];
+            return top - 1;
+        } else if constexpr (ins.op == OpCode::Sub) {
+            top[-2] = top[-2] - top[-1];
+            return top - 1;
+        } else if constexpr (ins.op == OpCode::Div) {
+            top[-2] = top[-2] / top[-1];
+            return top - 1;
+        } else if constexpr (ins.op == OpCode::Mul) {
+            top[-2] = top[-2] * top[-1];
+            return top - 1;
+        } else if constexpr (ins.op == OpCode::Mod) {
+            top[-2] = top[-2] % top[-1];
+            return top - 1;
+        } else if constexpr (ins.op == OpCode::Abs) {
+            top[-1] = top[-1] < 0 ? -top[-1] : top[-1];
+            return top;
+        } else if constexpr (ins.op == OpCode::Dup) {
+            *top = top[-1];
+            return top + 1;
+        } else {
+            *top = read_input();
+            return top + 1;
+        }
+    }
+};
+
+template<FixedString Source>
+constexpr auto compile() {
+    return StaticProgram<parse_static_program<Source>()>{};
 }
+
+
+// Thread-safe cache of compiled programs keyed by source text.
+//
+// At most `capacity` programs, taking at most `byte_budget` bytes between
+// them, are kept; inserting past either limit evicts the least recently used
+// ones. An entry is charged for its source text and its bytecode, and one
+// larger than the whole budget is compiled but not cached. Programs are
+// shared and immutable, so callers may keep
+// using one after it has been evicted. Compilation happens outside the lock:
+// two threads missing on the same source may both compile it, and the first
+// one to finish wins.
+class ProgramCache {
+public:
+    explicit ProgramCache(std::size_t capacity,
+        std::size_t byte_budget = std::numeric_limits<std::size_t>::max())
+        : capacity(capacity), byte_budget(byte_budget) {}
+
+    ProgramCache(const ProgramCache &) = delete;
+    ProgramCache &operator=(const ProgramCache &) = delete;
+
+    std::shared_ptr<const Statement> get(std::string_view source) {
+        {
+            std::lock_guard lock(mutex);
+            auto it = index.find(source);
+            if (it != index.end()) {
+                entries.splice(entries.begin(), entries, it->second);
+                return it->second->program;
+            }
+        }
+
+        std::shared_ptr<const Statement> program = compile(source);
+        std::size_t cost = entry_bytes(source, *program);
+        if (capacity == 0 || cost > byte_budget) {
+            return program;
+        }
+
+        std::lock_guard lock(mutex);
+        auto it = index.find(source);
+        if (it != index.end()) {
+            entries.splice(entries.begin(), entries, it->second);
+            return it->second->program;
+        }
+        entries.push_front({std::string(source), program, cost});
+        index.emplace(entries.front().source, entries.begin());
+        used += cost;
+        while (entries.size() > capacity || used > byte_budget) {
+            used -= entries.back().bytes;
+            index.erase(entries.back().source);
+            entries.pop_back();
+        }
+        return program;
+    }
+
+    std::size_t size() const {
+        std::lock_guard lock(mutex);
+        return entries.size();
+    }
+
+    // Bytes charged to the cached entries, as counted against byte_budget.
+    std::size_t bytes() const {
+        std::lock_guard lock(mutex);
+        return used;
+    }
+
+    void clear() {
+        std::lock_guard lock(mutex);
+        index.clear();
+        entries.clear();
+        used = 0;
+    }
+
+private:
+    struct Entry {
+        std::string source;
+        std::shared_ptr<const Statement> program;
+        std::size_t bytes;
+    };
+
+    static std::size_t entry_bytes(std::string_view source, const Statement &program) {
+        std::size_t bytes = source.size();
+        if (auto *compiled = dynamic_cast<const Program *>(&program)) {
+            bytes += compiled->get_code().size() * sizeof(Instruction);
+        }
+        return bytes;
+    }
+
+    std::size_t capacity;
+    std::size_t byte_budget;
+    std::size_t used = 0;
+    mutable std::mutex mutex;
+    // Most recently used first; index keys are views into Entry::source.
+    std::list<Entry> entries;
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+};
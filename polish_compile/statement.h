@@ -1,11 +1,30 @@
+#pragma once
+
 #include <vector>
 
 class Statement {  
 public:  
-    virtual std::vector<int> apply(std::vector<int> in) const = 0;  
+    // Runs the statement on a caller-owned stack, mutating it in place.
+    //
+    // Statements are immutable once built, so one statement may be applied
+    // from many threads at once as long as every call gets its own stack.
+    // Pure statements touch nothing else; Input reads from the calling
+    // thread's current InputSource.
+    virtual void apply_inplace(std::vector<int> &stack) const = 0;
+
+    std::vector<int> apply(std::vector<int> in) const {
+        if (in.size() >= arguments) {
+            in.reserve(in.size() - arguments + max_depth);
+        }
+        apply_inplace(in);
+        return in;
+    }
 
     Statement() = default;  
-    Statement(unsigned arguments, unsigned results, bool pure): arguments(arguments), results(results), pure(pure) {}  
+    Statement(unsigned arguments, unsigned results, bool pure)
+        : Statement(arguments, results, pure, arguments > results ? arguments : results) {}
+    Statement(unsigned arguments, unsigned results, bool pure, unsigned max_depth)
+        : arguments(arguments), results(results), pure(pure), max_depth(max_depth) {}
 
     virtual ~Statement() = default;  
 
@@ -21,8 +40,15 @@ public:
         return results;  
     }  
 
+    // Peak stack height while running, counted from below the statement's
+    // arguments. Lets executors size the stack once up front.
+    unsigned get_max_stack_depth() const {
+        return max_depth;
+    }
+
 protected:  
     unsigned arguments;  
     unsigned results;  
     bool pure;  
-};
\ No newline at end of file
+    unsigned max_depth;
+};
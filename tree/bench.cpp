@@ -0,0 +1,142 @@
+#include "searching_tree.h"
+
+#include "benchmark_support/allocation_counter.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Keys 0..n-1 in ascending order, or shuffled with a fixed seed. Sorted
+// input is the worst case for an Unbalanced tree, which degenerates into a
+// list, so those runs are kept small.
+static std::vector<int> make_keys(std::size_t n, bool sorted) {
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    if (!sorted) {
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+    }
+    return keys;
+}
+
+template<typename Balance>
+static void fill(SearchingTree<int, int, Balance> &tree, const std::vector<int> &keys) {
+    for (int key : keys) {
+        tree.insert(key, key);
+    }
+}
+
+template<typename Balance>
+static void BM_Insert(benchmark::State &state) {
+    bool sorted = state.range(1) != 0;
+    std::vector<int> keys = make_keys(state.range(0), sorted);
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        SearchingTree<int, int, Balance> tree;
+        fill(tree, keys);
+        benchmark::DoNotOptimize(tree.begin());
+    }
+    state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Looks every key up once, in shuffled order, in a tree built from the
+// sorted or shuffled keys.
+template<typename Balance>
+static void BM_Find(benchmark::State &state) {
+    bool sorted = state.range(1) != 0;
+    SearchingTree<int, int, Balance> tree;
+    fill(tree, make_keys(state.range(0), sorted));
+    std::vector<int> lookups = make_keys(state.range(0), false);
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        for (int key : lookups) {
+            benchmark::DoNotOptimize(tree.find(key));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * lookups.size());
+}
+
+// 64-key windows at shuffled starting points, materialized through range().
+template<typename Balance>
+static void BM_Range(benchmark::State &state) {
+    bool sorted = state.range(1) != 0;
+    constexpr int width = 64;
+    SearchingTree<int, int, Balance> tree;
+    fill(tree, make_keys(state.range(0), sorted));
+    std::vector<int> starts = make_keys(state.range(0) / width, false);
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        for (int start : starts) {
+            benchmark::DoNotOptimize(tree.range(start * width, start * width + width));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * starts.size() * width);
+}
+
+// The same windows through range_view(), which materializes nothing.
+template<typename Balance>
+static void BM_RangeView(benchmark::State &state) {
+    bool sorted = state.range(1) != 0;
+    constexpr int width = 64;
+    SearchingTree<int, int, Balance> tree;
+    fill(tree, make_keys(state.range(0), sorted));
+    std::vector<int> starts = make_keys(state.range(0) / width, false);
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        long sum = 0;
+        for (int start : starts) {
+            for (auto [key, value] : tree.range_view(start * width, start * width + width)) {
+                sum += value;
+            }
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * starts.size() * width);
+}
+
+template<typename Balance>
+static void BM_Iterate(benchmark::State &state) {
+    bool sorted = state.range(1) != 0;
+    SearchingTree<int, int, Balance> tree;
+    fill(tree, make_keys(state.range(0), sorted));
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        long sum = 0;
+        for (auto [key, value] : tree) {
+            sum += value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Arguments are (size, sorted). Sorted Unbalanced runs are quadratic, so
+// they stop at 4096 keys.
+static void unbalanced_arguments(benchmark::internal::Benchmark *bench) {
+    bench->ArgNames({"n", "sorted"});
+    for (int n = 1 << 10; n <= 1 << 12; n *= 4) {
+        bench->Args({n, 1});
+    }
+    for (int n = 1 << 10; n <= 1 << 19; n *= 8) {
+        bench->Args({n, 0});
+    }
+}
+
+static void balanced_arguments(benchmark::internal::Benchmark *bench) {
+    bench->ArgNames({"n", "sorted"});
+    bench->ArgsProduct({benchmark::CreateRange(1 << 10, 1 << 19, 8), {1, 0}});
+}
+
+#define TREE_BENCHMARKS(bench)                                          \
+    BENCHMARK_TEMPLATE(bench, Unbalanced)->Apply(unbalanced_arguments); \
+    BENCHMARK_TEMPLATE(bench, AvlBalanced)->Apply(balanced_arguments)
+
+TREE_BENCHMARKS(BM_Insert);
+TREE_BENCHMARKS(BM_Find);
+TREE_BENCHMARKS(BM_Range);
+TREE_BENCHMARKS(BM_RangeView);
+TREE_BENCHMARKS(BM_Iterate);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,513 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// Fan-out that keeps a node's key array within a few cache lines.
+template<typename K, typename V>
+constexpr std::size_t bplus_leaf_capacity = std::max<std::size_t>(4, 256 / (sizeof(K) + sizeof(V)));
+
+template<typename K>
+constexpr std::size_t bplus_inner_capacity = std::max<std::size_t>(4, 256 / (sizeof(K) + sizeof(void*)));
+
+// B+-tree with the same interface as SearchingTree. Keys and values are
+// stored many to a node in contiguous arrays, and leaves are linked in both
+// directions, so lookups touch one node per level and iteration and range()
+// are sequential scans over the leaves. A node's arrays are raw storage of
+// which only the first `count` slots hold keys and values, so neither type
+// needs a default constructor and a new node constructs nothing.
+template<typename K, typename V,
+    std::size_t LeafCapacity = bplus_leaf_capacity<K, V>,
+    std::size_t InnerCapacity = bplus_inner_capacity<K>>
+class BPlusTree {
+private:
+    static_assert(LeafCapacity >= 4 && InnerCapacity >= 4, "B+-tree nodes need room for at least four keys");
+
+    static constexpr std::size_t minLeafKeys = LeafCapacity / 2;
+    static constexpr std::size_t minInnerKeys = InnerCapacity / 2;
+
+    struct Node {
+        bool leaf;
+        std::size_t count = 0;
+        explicit Node(bool leaf) : leaf(leaf) {}
+    };
+
+    // Uninitialized room for `Capacity` objects of type T.
+    template<typename T, std::size_t Capacity>
+    struct Slots {
+        alignas(T) std::byte storage[sizeof(T) * Capacity];
+
+        T* data() {
+            return reinterpret_cast<T*>(storage);
+        }
+
+        const T* data() const {
+            return reinterpret_cast<const T*>(storage);
+        }
+    };
+
+    struct Leaf : Node {
+        Slots<K, LeafCapacity> keySlots;
+        Slots<V, LeafCapacity> valueSlots;
+        Leaf* prev = nullptr;
+        Leaf* next = nullptr;
+        Leaf() : Node(true) {}
+
+        ~Leaf() {
+            std::destroy_n(keys(), this->count);
+            std::destroy_n(values(), this->count);
+        }
+
+        K* keys() {
+            return keySlots.data();
+        }
+
+        const K* keys() const {
+            return keySlots.data();
+        }
+
+        V* values() {
+            return valueSlots.data();
+        }
+
+        const V* values() const {
+            return valueSlots.data();
+        }
+    };
+
+    // children[i] holds keys below keys()[i]; children[i + 1] holds the rest.
+    struct Inner : Node {
+        Slots<K, InnerCapacity> keySlots;
+        Node* children[InnerCapacity + 1];
+        Inner() : Node(false) {}
+
+        ~Inner() {
+            std::destroy_n(keys(), this->count);
+        }
+
+        K* keys() {
+            return keySlots.data();
+        }
+
+        const K* keys() const {
+            return keySlots.data();
+        }
+    };
+
+    struct PathEntry {
+        Inner* node;
+        std::size_t index;
+    };
+
+    Node* root = nullptr;
+
+    // Inserts `value` at `index` of the `count` live slots, constructing the
+    // slot the last one moves into.
+    template<typename T, typename Arg>
+    static void insertSlot(T* slots, std::size_t count, std::size_t index, Arg&& value) {
+        if (index == count) {
+            std::construct_at(slots + count, std::forward<Arg>(value));
+            return;
+        }
+        std::construct_at(slots + count, std::move(slots[count - 1]));
+        std::move_backward(slots + index, slots + count - 1, slots + count);
+        slots[index] = std::forward<Arg>(value);
+    }
+
+    // Removes slot `index` of `count`, destroying the one left empty at the end.
+    template<typename T>
+    static void eraseSlot(T* slots, std::size_t count, std::size_t index) {
+        std::move(slots + index + 1, slots + count, slots + index);
+        std::destroy_at(slots + count - 1);
+    }
+
+    // Moves `count` live slots into empty ones and destroys the originals.
+    template<typename T>
+    static void moveSlots(T* from, std::size_t count, T* to) {
+        std::uninitialized_move_n(from, count, to);
+        std::destroy_n(from, count);
+    }
+
+    static std::size_t childIndex(const Inner* node, const K& key) {
+        return std::upper_bound(node->keys(), node->keys() + node->count, key) - node->keys();
+    }
+
+    Leaf* findLeaf(const K& key, std::vector<PathEntry>* path = nullptr) const {
+        Node* node = root;
+        while (node && !node->leaf) {
+            Inner* inner = static_cast<Inner*>(node);
+            std::size_t index = childIndex(inner, key);
+            if (path) {
+                path->push_back({inner, index});
+            }
+            node = inner->children[index];
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    // First position whose key is not less than `key`, or end.
+    std::pair<Leaf*, std::size_t> lowerBound(const K& key) const {
+        Leaf* leaf = findLeaf(key);
+        if (!leaf) {
+            return {nullptr, 0};
+        }
+        std::size_t index = std::lower_bound(leaf->keys(), leaf->keys() + leaf->count, key) - leaf->keys();
+        if (index == leaf->count) {
+            return {leaf->next, 0};
+        }
+        return {leaf, index};
+    }
+
+    static void destroy(Node* node) {
+        if (!node) {
+            return;
+        }
+        if (!node->leaf) {
+            Inner* inner = static_cast<Inner*>(node);
+            for (std::size_t i = 0; i <= inner->count; ++i) {
+                destroy(inner->children[i]);
+            }
+            delete inner;
+        } else {
+            delete static_cast<Leaf*>(node);
+        }
+    }
+
+    // Moves the upper half of a full leaf into a new right sibling.
+    static Leaf* splitLeaf(Leaf* leaf) {
+        Leaf* right = new Leaf();
+        std::size_t half = leaf->count / 2;
+        moveSlots(leaf->keys() + half, leaf->count - half, right->keys());
+        moveSlots(leaf->values() + half, leaf->count - half, right->values());
+        right->count = leaf->count - half;
+        leaf->count = half;
+
+        right->next = leaf->next;
+        right->prev = leaf;
+        if (leaf->next) {
+            leaf->next->prev = right;
+        }
+        leaf->next = right;
+        return right;
+    }
+
+    // Splits a full inner node and returns the new right half together with
+    // the middle key, which moves up.
+    static std::pair<Inner*, K> splitInner(Inner* node) {
+        Inner* right = new Inner();
+        std::size_t half = node->count / 2;
+        K separator = std::move(node->keys()[half]);
+        moveSlots(node->keys() + half + 1, node->count - half - 1, right->keys());
+        std::destroy_at(node->keys() + half);
+        right->count = node->count - half - 1;
+        std::copy(node->children + half + 1, node->children + node->count + 1, right->children);
+        node->count = half;
+        return {right, std::move(separator)};
+    }
+
+    static void insertIntoInner(Inner* node, std::size_t index, K separator, Node* right) {
+        insertSlot(node->keys(), node->count, index, std::move(separator));
+        std::copy_backward(node->children + index + 1, node->children + node->count + 1,
+            node->children + node->count + 2);
+        node->children[index + 1] = right;
+        ++node->count;
+    }
+
+    static void eraseFromInner(Inner* node, std::size_t index) {
+        eraseSlot(node->keys(), node->count, index);
+        std::copy(node->children + index + 2, node->children + node->count + 1, node->children + index + 1);
+        --node->count;
+    }
+
+    void fixLeafUnderflow(Leaf* leaf, std::vector<PathEntry>& path) {
+        auto [parent, index] = path.back();
+        Leaf* left = index > 0 ? static_cast<Leaf*>(parent->children[index - 1]) : nullptr;
+        Leaf* right = index < parent->count ? static_cast<Leaf*>(parent->children[index + 1]) : nullptr;
+
+        if (left && left->count > minLeafKeys) {
+            insertSlot(leaf->keys(), leaf->count, 0, std::move(left->keys()[left->count - 1]));
+            insertSlot(leaf->values(), leaf->count, 0, std::move(left->values()[left->count - 1]));
+            std::destroy_at(left->keys() + left->count - 1);
+            std::destroy_at(left->values() + left->count - 1);
+            --left->count;
+            ++leaf->count;
+            parent->keys()[index - 1] = leaf->keys()[0];
+            return;
+        }
+        if (right && right->count > minLeafKeys) {
+            std::construct_at(leaf->keys() + leaf->count, std::move(right->keys()[0]));
+            std::construct_at(leaf->values() + leaf->count, std::move(right->values()[0]));
+            ++leaf->count;
+            eraseSlot(right->keys(), right->count, 0);
+            eraseSlot(right->values(), right->count, 0);
+            --right->count;
+            parent->keys()[index] = right->keys()[0];
+            return;
+        }
+
+        // Merge with a sibling; the right node of the pair is freed.
+        if (!left) {
+            left = leaf;
+            leaf = right;
+            ++index;
+        }
+        moveSlots(leaf->keys(), leaf->count, left->keys() + left->count);
+        moveSlots(leaf->values(), leaf->count, left->values() + left->count);
+        left->count += leaf->count;
+        leaf->count = 0;
+        left->next = leaf->next;
+        if (leaf->next) {
+            leaf->next->prev = left;
+        }
+        delete leaf;
+        eraseFromInner(parent, index - 1);
+        path.pop_back();
+        fixInnerUnderflow(parent, path);
+    }
+
+    void fixInnerUnderflow(Inner* node, std::vector<PathEntry>& path) {
+        if (path.empty()) {
+            if (node->count == 0) {
+                root = node->children[0];
+                delete node;
+            }
+            return;
+        }
+        if (node->count >= minInnerKeys) {
+            return;
+        }
+
+        auto [parent, index] = path.back();
+        Inner* left = index > 0 ? static_cast<Inner*>(parent->children[index - 1]) : nullptr;
+        Inner* right = index < parent->count ? static_cast<Inner*>(parent->children[index + 1]) : nullptr;
+
+        if (left && left->count > minInnerKeys) {
+            insertSlot(node->keys(), node->count, 0, std::move(parent->keys()[index - 1]));
+            std::copy_backward(node->children, node->children + node->count + 1, node->children + node->count + 2);
+            node->children[0] = left->children[left->count];
+            parent->keys()[index - 1] = std::move(left->keys()[left->count - 1]);
+            std::destroy_at(left->keys() + left->count - 1);
+            --left->count;
+            ++node->count;
+            return;
+        }
+        if (right && right->count > minInnerKeys) {
+            std::construct_at(node->keys() + node->count, std::move(parent->keys()[index]));
+            node->children[node->count + 1] = right->children[0];
+            ++node->count;
+            parent->keys()[index] = std::move(right->keys()[0]);
+            eraseSlot(right->keys(), right->count, 0);
+            std::copy(right->children + 1, right->children + right->count + 1, right->children);
+            --right->count;
+            return;
+        }
+
+        if (!left) {
+            left = node;
+            node = right;
+            ++index;
+        }
+        std::construct_at(left->keys() + left->count, std::move(parent->keys()[index - 1]));
+        moveSlots(node->keys(), node->count, left->keys() + left->count + 1);
+        std::copy(node->children, node->children + node->count + 1, left->children + left->count + 1);
+        left->count += node->count + 1;
+        node->count = 0;
+        delete node;
+        eraseFromInner(parent, index - 1);
+        path.pop_back();
+        fixInnerUnderflow(parent, path);
+    }
+
+public:
+    class Iterator {
+    public:
+        Iterator(Leaf* leaf, std::size_t index) : leaf(leaf), index(index) {}
+
+        std::pair<const K&, V&> operator*() const {
+            return {leaf->keys()[index], leaf->values()[index]};
+        }
+
+        Iterator& operator++() {
+            if (++index == leaf->count) {
+                leaf = leaf->next;
+                index = 0;
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return leaf == other.leaf && index == other.index;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Leaf* leaf;
+        std::size_t index;
+    };
+
+    BPlusTree() = default;
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+
+    BPlusTree(BPlusTree&& other) noexcept : root(std::exchange(other.root, nullptr)) {}
+
+    BPlusTree& operator=(BPlusTree&& other) noexcept {
+        std::swap(root, other.root);
+        return *this;
+    }
+
+    ~BPlusTree() {
+        destroy(root);
+    }
+
+    void insert(const K& key, const V& value) {
+        if (!root) {
+            Leaf* leaf = new Leaf();
+            std::construct_at(leaf->keys(), key);
+            std::construct_at(leaf->values(), value);
+            leaf->count = 1;
+            root = leaf;
+            return;
+        }
+
+        std::vector<PathEntry> path;
+        Leaf* leaf = findLeaf(key, &path);
+        std::size_t index = std::lower_bound(leaf->keys(), leaf->keys() + leaf->count, key) - leaf->keys();
+        if (index < leaf->count && !(key < leaf->keys()[index])) {
+            return;
+        }
+
+        Node* right = nullptr;
+        std::optional<K> separator;
+        if (leaf->count == LeafCapacity) {
+            Leaf* sibling = splitLeaf(leaf);
+            if (index > leaf->count) {
+                index -= leaf->count;
+                leaf = sibling;
+            }
+            right = sibling;
+        }
+        insertSlot(leaf->keys(), leaf->count, index, key);
+        insertSlot(leaf->values(), leaf->count, index, value);
+        ++leaf->count;
+        if (right) {
+            separator.emplace(static_cast<Leaf*>(right)->keys()[0]);
+        }
+
+        // Push the split up until some ancestor has room for the separator.
+        while (right) {
+            if (path.empty()) {
+                Inner* top = new Inner();
+                std::construct_at(top->keys(), std::move(*separator));
+                top->children[0] = root;
+                top->children[1] = right;
+                top->count = 1;
+                root = top;
+                return;
+            }
+            auto [parent, position] = path.back();
+            path.pop_back();
+
+            if (parent->count < InnerCapacity) {
+                insertIntoInner(parent, position, std::move(*separator), right);
+                return;
+            }
+            auto [sibling, up] = splitInner(parent);
+            if (position <= parent->count) {
+                insertIntoInner(parent, position, std::move(*separator), right);
+            } else {
+                insertIntoInner(sibling, position - parent->count - 1, std::move(*separator), right);
+            }
+            separator = std::move(up);
+            right = sibling;
+        }
+    }
+
+    void erase(const K& key) {
+        std::vector<PathEntry> path;
+        Leaf* leaf = findLeaf(key, &path);
+        if (!leaf) {
+            return;
+        }
+        std::size_t index = std::lower_bound(leaf->keys(), leaf->keys() + leaf->count, key) - leaf->keys();
+        if (index == leaf->count || key < leaf->keys()[index]) {
+            return;
+        }
+
+        eraseSlot(leaf->keys(), leaf->count, index);
+        eraseSlot(leaf->values(), leaf->count, index);
+        --leaf->count;
+
+        if (path.empty()) {
+            if (leaf->count == 0) {
+                delete leaf;
+                root = nullptr;
+            }
+            return;
+        }
+        if (leaf->count < minLeafKeys) {
+            fixLeafUnderflow(leaf, path);
+        }
+    }
+
+    std::optional<std::pair<K, V>> find(const K& key) const {
+        auto [leaf, index] = lowerBound(key);
+        if (leaf && !(key < leaf->keys()[index])) {
+            return std::make_pair(leaf->keys()[index], leaf->values()[index]);
+        }
+        return std::nullopt;
+    }
+
+    Iterator begin() const {
+        Node* node = root;
+        while (node && !node->leaf) {
+            node = static_cast<Inner*>(node)->children[0];
+        }
+        return Iterator(static_cast<Leaf*>(node), 0);
+    }
+
+    Iterator end() const {
+        return Iterator(nullptr, 0);
+    }
+
+    // Same contract as SearchingTree::range: keys in [a, b) ascending, or in
+    // [b, a) descending when a > b. Both directions walk the leaf chain.
+    std::vector<std::pair<K, V>> range(K a, K b) {
+        std::vector<std::pair<K, V>> result;
+        if (a < b) {
+            for (auto [leaf, index] = lowerBound(a); leaf; leaf = leaf->next, index = 0) {
+                for (; index < leaf->count; ++index) {
+                    if (!(leaf->keys()[index] < b)) {
+                        return result;
+                    }
+                    result.emplace_back(leaf->keys()[index], leaf->values()[index]);
+                }
+            }
+        } else {
+            Leaf* leaf = findLeaf(a);
+            if (!leaf) {
+                return result;
+            }
+            std::size_t index = std::lower_bound(leaf->keys(), leaf->keys() + leaf->count, a) - leaf->keys();
+            while (leaf) {
+                while (index > 0) {
+                    --index;
+                    if (leaf->keys()[index] < b) {
+                        return result;
+                    }
+                    result.emplace_back(leaf->keys()[index], leaf->values()[index]);
+                }
+                leaf = leaf->prev;
+                index = leaf ? leaf->count : 0;
+            }
+        }
+        return result;
+    }
+};
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Ordered map for read-mostly sharing between threads. Nodes are immutable
+// once published: a writer copies the path it changes, rebalances the copies
+// as an AVL tree and publishes the new root with a single atomic store, so
+// readers never wait on anything and always see a consistent version.
+//
+// Replaced nodes are reclaimed by epochs. A reader announces the current
+// epoch in one of ReaderSlots cache-line sized slots for the duration of a
+// lookup; nodes retired in epoch E are freed once no announced epoch is E or
+// older. Writers serialize on a mutex.
+template<typename K, typename V, std::size_t ReaderSlots = 128>
+class ConcurrentTree {
+private:
+    struct Node {
+        K key;
+        V value;
+        const Node* left;
+        const Node* right;
+        int height;
+    };
+
+    // An AVL tree of 2^64 nodes is less than 96 levels deep, so traversals
+    // keep their path in a fixed array.
+    static constexpr std::size_t max_height = 96;
+    static constexpr std::uint64_t idle = std::numeric_limits<std::uint64_t>::max();
+
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> epoch{idle};
+    };
+
+    // Holds a reader slot for its lifetime. Threads start probing at a slot
+    // picked from their id, so concurrent readers rarely share a cache line.
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const ConcurrentTree& tree) {
+            std::size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+            for (std::size_t i = 0;; ++i) {
+                Slot& candidate = tree.slots[(start + i) % ReaderSlots];
+                std::uint64_t expected = idle;
+                if (candidate.epoch.compare_exchange_strong(expected, tree.epoch.load())) {
+                    slot = &candidate;
+                    return;
+                }
+                if (i % ReaderSlots == ReaderSlots - 1) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        ~ReadGuard() {
+            slot->epoch.store(idle);
+        }
+
+    private:
+        Slot* slot;
+    };
+
+    std::atomic<const Node*> root{nullptr};
+    std::atomic<std::uint64_t> epoch{0};
+    mutable std::array<Slot, ReaderSlots> slots;
+
+    std::mutex writer;
+    std::vector<const Node*> replaced;
+    std::vector<std::pair<std::uint64_t, const Node*>> retired;
+
+    static int height(const Node* node) {
+        return node ? node->height : 0;
+    }
+
+    static const Node* makeNode(const K& key, const V& value, const Node* left, const Node* right) {
+        return new Node{key, value, left, right, 1 + std::max(height(left), height(right))};
+    }
+
+    // Builds the node (key, value, left, right), rotating when the children
+    // differ in height by two. Rotated nodes are copied, never modified.
+    const Node* balance(const K& key, const V& value, const Node* left, const Node* right) {
+        int factor = height(left) - height(right);
+        if (factor > 1) {
+            replaced.push_back(left);
+            if (height(left->left) >= height(left->right)) {
+                return makeNode(left->key, left->value, left->left,
+                    makeNode(key, value, left->right, right));
+            }
+            const Node* middle = left->right;
+            replaced.push_back(middle);
+            return makeNode(middle->key, middle->value,
+                makeNode(left->key, left->value, left->left, middle->left),
+                makeNode(key, value, middle->right, right));
+        }
+        if (factor < -1) {
+            replaced.push_back(right);
+            if (height(right->right) >= height(right->left)) {
+                return makeNode(right->key, right->value,
+                    makeNode(key, value, left, right->left), right->right);
+            }
+            const Node* middle = right->left;
+            replaced.push_back(middle);
+            return makeNode(middle->key, middle->value,
+                makeNode(key, value, left, middle->left),
+                makeNode(right->key, right->value, middle->right, right->right));
+        }
+        return makeNode(key, value, left, right);
+    }
+
+    // Copy of `node` with new children; the original is retired.
+    const Node* rebuild(const Node* node, const Node* left, const Node* right) {
+        replaced.push_back(node);
+        return balance(node->key, node->value, left, right);
+    }
+
+    const Node* insertNode(const Node* node, const K& key, const V& value, bool& changed) {
+        if (!node) {
+            changed = true;
+            return makeNode(key, value, nullptr, nullptr);
+        }
+        if (key < node->key) {
+            const Node* left = insertNode(node->left, key, value, changed);
+            return changed ? rebuild(node, left, node->right) : node;
+        }
+        if (node->key < key) {
+            const Node* right = insertNode(node->right, key, value, changed);
+            return changed ? rebuild(node, node->left, right) : node;
+        }
+        return node;
+    }
+
+    const Node* eraseMin(const Node* node) {
+        if (!node->left) {
+            replaced.push_back(node);
+            return node->right;
+        }
+        return rebuild(node, eraseMin(node->left), node->right);
+    }
+
+    const Node* eraseNode(const Node* node, const K& key, bool& changed) {
+        if (!node) {
+            return nullptr;
+        }
+        if (key < node->key) {
+            const Node* left = eraseNode(node->left, key, changed);
+            return changed ? rebuild(node, left, node->right) : node;
+        }
+        if (node->key < key) {
+            const Node* right = eraseNode(node->right, key, changed);
+            return changed ? rebuild(node, node->left, right) : node;
+        }
+        changed = true;
+        replaced.push_back(node);
+        if (!node->left || !node->right) {
+            return node->left ? node->left : node->right;
+        }
+        const Node* successor = node->right;
+        while (successor->left) {
+            successor = successor->left;
+        }
+        return balance(successor->key, successor->value, node->left, eraseMin(node->right));
+    }
+
+    // Makes `next` the visible version. Everything replaced to build it is
+    // tagged with the epoch that ends here and freed once no reader that
+    // could have seen the previous version is still announced.
+    void publish(const Node* next) {
+        root.store(next);
+        std::uint64_t ended = epoch.fetch_add(1);
+        for (const Node* node : replaced) {
+            retired.emplace_back(ended, node);
+        }
+        replaced.clear();
+
+        std::uint64_t oldest = epoch.load();
+        for (const Slot& slot : slots) {
+            oldest = std::min(oldest, slot.epoch.load());
+        }
+        auto reclaimable = std::find_if(retired.begin(), retired.end(), [oldest](const auto& entry) {
+            return entry.first >= oldest;
+        });
+        for (auto it = retired.begin(); it != reclaimable; ++it) {
+            delete it->second;
+        }
+        retired.erase(retired.begin(), reclaimable);
+    }
+
+    static void destroyTree(const Node* node) {
+        if (node) {
+            destroyTree(node->left);
+            destroyTree(node->right);
+            delete node;
+        }
+    }
+
+    // In-order walk over [from, to) ascending, or [to, from) descending when
+    // `reverse` is set, calling visit(key, value) for each entry.
+    template<typename F>
+    static void visitRange(const Node* node, const K& from, const K& to, bool reverse, F& visit) {
+        std::array<const Node*, max_height> path;
+        std::size_t depth = 0;
+        while (node) {
+            if (reverse ? node->key < from : !(node->key < from)) {
+                path[depth++] = node;
+                node = reverse ? node->right : node->left;
+            } else {
+                node = reverse ? node->left : node->right;
+            }
+        }
+        while (depth > 0) {
+            const Node* current = path[--depth];
+            if (reverse ? current->key < to : !(current->key < to)) {
+                return;
+            }
+            visit(current->key, current->value);
+            for (node = reverse ? current->left : current->right; node;
+                 node = reverse ? node->right : node->left) {
+                path[depth++] = node;
+            }
+        }
+    }
+
+public:
+    ConcurrentTree() = default;
+
+    ConcurrentTree(const ConcurrentTree&) = delete;
+    ConcurrentTree& operator=(const ConcurrentTree&) = delete;
+
+    // No reader or writer may still be running.
+    ~ConcurrentTree() {
+        destroyTree(root.load());
+        for (const auto& entry : retired) {
+            delete entry.second;
+        }
+    }
+
+    void insert(const K& key, const V& value) {
+        std::lock_guard<std::mutex> lock(writer);
+        bool changed = false;
+        const Node* next = insertNode(root.load(), key, value, changed);
+        if (changed) {
+            publish(next);
+        }
+    }
+
+    void erase(const K& key) {
+        std::lock_guard<std::mutex> lock(writer);
+        bool changed = false;
+        const Node* next = eraseNode(root.load(), key, changed);
+        if (changed) {
+            publish(next);
+        }
+    }
+
+    std::optional<std::pair<K, V>> find(const K& key) const {
+        ReadGuard guard(*this);
+        const Node* node = root.load();
+        while (node) {
+            if (key < node->key) {
+                node = node->left;
+            } else if (node->key < key) {
+                node = node->right;
+            } else {
+                return std::make_pair(node->key, node->value);
+            }
+        }
+        return std::nullopt;
+    }
+
+    bool contains(const K& key) const {
+        return find(key).has_value();
+    }
+
+    // Calls visit(key, value) for keys in [a, b) ascending, or in [b, a)
+    // descending when a >= b, all from one consistent version. Writers are
+    // not held up; only reclamation waits for the walk to finish.
+    template<typename F>
+    void visit_range(const K& a, const K& b, F visit) const {
+        ReadGuard guard(*this);
+        visitRange(root.load(), a, b, !(a < b), visit);
+    }
+
+    // Calls visit(key, value) for every entry in key order.
+    template<typename F>
+    void for_each(F visit) const {
+        ReadGuard guard(*this);
+        const Node* node = root.load();
+        std::array<const Node*, max_height> path;
+        std::size_t depth = 0;
+        while (node || depth > 0) {
+            for (; node; node = node->left) {
+                path[depth++] = node;
+            }
+            const Node* current = path[--depth];
+            visit(current->key, current->value);
+            node = current->right;
+        }
+    }
+
+    std::vector<std::pair<K, V>> range(K a, K b) const {
+        std::vector<std::pair<K, V>> result;
+        visit_range(a, b, [&result](const K& key, const V& value) {
+            result.emplace_back(key, value);
+        });
+        return result;
+    }
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Slab storage for nodes of one size, shared by the NodePools of one
+// NodePoolResourceSet. Single-node allocations are carved out of large slabs
+// and recycled through an intrusive free list; the slabs themselves are only
+// returned to the system, all at once, when the last allocator referring to
+// them goes away.
+class NodePoolResource {
+public:
+    NodePoolResource(std::size_t node_size, std::size_t node_align, std::size_t nodes_per_slab)
+        : node_size(round_up(std::max(node_size, sizeof(FreeNode)), std::max(node_align, alignof(FreeNode)))),
+          node_align(std::max(node_align, alignof(FreeNode))), nodes_per_slab(nodes_per_slab) {}
+
+    NodePoolResource(const NodePoolResource&) = delete;
+    NodePoolResource& operator=(const NodePoolResource&) = delete;
+
+    ~NodePoolResource() {
+        for (std::byte* slab : slabs) {
+            ::operator delete(slab, std::align_val_t(node_align));
+        }
+    }
+
+    void* allocate() {
+        if (free_list) {
+            FreeNode* node = free_list;
+            free_list = node->next;
+            return node;
+        }
+        if (used == nodes_per_slab || slabs.empty()) {
+            slabs.push_back(static_cast<std::byte*>(
+                ::operator new(node_size * nodes_per_slab, std::align_val_t(node_align))));
+            used = 0;
+        }
+        return slabs.back() + node_size * used++;
+    }
+
+    void deallocate(void* pointer) noexcept {
+        FreeNode* node = static_cast<FreeNode*>(pointer);
+        node->next = free_list;
+        free_list = node;
+    }
+
+    std::size_t slab_count() const {
+        return slabs.size();
+    }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    static std::size_t round_up(std::size_t size, std::size_t align) {
+        return (size + align - 1) / align * align;
+    }
+
+    std::size_t node_size;
+    std::size_t node_align;
+    std::size_t nodes_per_slab;
+    std::vector<std::byte*> slabs;
+    std::size_t used = 0;
+    FreeNode* free_list = nullptr;
+};
+
+// The NodePoolResources of one family of NodePools, one per node size and
+// alignment, created as the family is rebound to new types.
+class NodePoolResourceSet {
+public:
+    explicit NodePoolResourceSet(std::size_t nodes_per_slab) : nodes_per_slab(nodes_per_slab) {}
+
+    NodePoolResource* get(std::size_t node_size, std::size_t node_align) {
+        for (Entry& entry : entries) {
+            if (entry.size == node_size && entry.align == node_align) {
+                return entry.resource.get();
+            }
+        }
+        entries.push_back({node_size, node_align,
+            std::make_unique<NodePoolResource>(node_size, node_align, nodes_per_slab)});
+        return entries.back().resource.get();
+    }
+
+private:
+    struct Entry {
+        std::size_t size;
+        std::size_t align;
+        std::unique_ptr<NodePoolResource> resource;
+    };
+
+    std::size_t nodes_per_slab;
+    std::vector<Entry> entries;
+};
+
+// Allocator for node-based containers such as SearchingTree. Copies and
+// rebound copies share one NodePoolResourceSet and compare equal; each type
+// draws from the set's pool for its size and alignment, which is how the
+// container's node type gets its own slabs. Requests for more than one
+// object go straight to operator new. Not thread-safe: a pool belongs to the
+// containers of a single thread.
+template<typename T, std::size_t NodesPerSlab = 1024>
+class NodePool {
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    template<typename U>
+    struct rebind {
+        using other = NodePool<U, NodesPerSlab>;
+    };
+
+    NodePool() : NodePool(std::make_shared<NodePoolResourceSet>(NodesPerSlab)) {}
+
+    // Copies rather than moves, so a moved-from pool still equals the moved-to
+    // one, as allocators must.
+    NodePool(const NodePool&) = default;
+    NodePool& operator=(const NodePool&) = default;
+
+    template<typename U>
+    NodePool(const NodePool<U, NodesPerSlab>& other) : NodePool(other.resources) {}
+
+    T* allocate(std::size_t n) {
+        if (n == 1) {
+            return static_cast<T*>(resource->allocate());
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* pointer, std::size_t n) noexcept {
+        if (n == 1) {
+            resource->deallocate(pointer);
+        } else {
+            std::allocator<T>().deallocate(pointer, n);
+        }
+    }
+
+    std::size_t slab_count() const {
+        return resource->slab_count();
+    }
+
+    template<typename U>
+    bool operator==(const NodePool<U, NodesPerSlab>& other) const {
+        return resources == other.resources;
+    }
+
+private:
+    template<typename, std::size_t>
+    friend class NodePool;
+
+    explicit NodePool(std::shared_ptr<NodePoolResourceSet> resources)
+        : resources(std::move(resources)), resource(this->resources->get(sizeof(T), alignof(T))) {}
+
+    std::shared_ptr<NodePoolResourceSet> resources;
+    NodePoolResource* resource;
+};
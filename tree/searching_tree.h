@@ -0,0 +1,843 @@
+#pragma once
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Balancing policies for SearchingTree. Unbalanced is a plain BST; AvlBalanced
+// keeps the tree height-balanced, so every operation is O(log n) and the
+// recursive helpers never go deeper than the tree height.
+struct Unbalanced {};
+struct AvlBalanced {};
+
+// Augmentation policies for SearchingTree. OrderStatistics keeps subtree
+// sizes, which gives rank, select and count in O(height). Aggregated<Monoid>
+// also keeps a fold of every subtree under Monoid, which must provide
+//
+//     using type = ...;
+//     static type identity();
+//     static type lift(const K& key, const V& value);
+//     static type combine(const type& left, const type& right);  // associative
+//
+// and enables aggregate(a, b). Both are maintained by every modification of
+// the tree's structure; a value changed in place through get() or an
+// iterator is not seen until its node is next rebuilt, so use assign().
+struct NoAugment {};
+struct OrderStatistics {};
+
+template<typename Monoid>
+struct Aggregated {
+    using monoid = Monoid;
+};
+
+// Sum of the values, for Aggregated<ValueSum<T>>.
+template<typename T>
+struct ValueSum {
+    using type = T;
+
+    static type identity() {
+        return T{};
+    }
+
+    template<typename K, typename V>
+    static type lift(const K&, const V& value) {
+        return value;
+    }
+
+    static type combine(const type& left, const type& right) {
+        return left + right;
+    }
+};
+
+// A tree node. `parent` lets iterators step in either direction without
+// keeping a path, so walking the whole tree is amortized O(1) per step.
+template<typename K, typename V>
+struct Pair {
+    K key;
+    V value;
+    Pair<K, V>* left;
+    Pair<K, V>* right;
+    Pair<K, V>* parent = nullptr;
+    int height = 1;
+    Pair(const K& k, const V& v) : key(k), value(v), left(nullptr), right(nullptr) {}
+
+    // Builds the key and the value in place from forwarded arguments.
+    template<typename KeyArg, typename... Args>
+    Pair(std::in_place_t, KeyArg&& k, Args&&... args)
+        : key(std::forward<KeyArg>(k)), value(std::forward<Args>(args)...), left(nullptr), right(nullptr) {}
+
+    Pair<K, V>* next() {
+        Pair<K, V>* node = this;
+        if (node->right) {
+            node = node->right;
+            while (node->left) {
+                node = node->left;
+            }
+            return node;
+        }
+        while (node->parent && node->parent->right == node) {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
+    Pair<K, V>* prev() {
+        Pair<K, V>* node = this;
+        if (node->left) {
+            node = node->left;
+            while (node->right) {
+                node = node->right;
+            }
+            return node;
+        }
+        while (node->parent && node->parent->left == node) {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+};
+
+// Node with the bookkeeping an augmentation policy needs. The tree links
+// nodes as Pair<K, V>*, so iterators are the same for every policy.
+template<typename K, typename V, typename Augment>
+struct AugmentedPair : Pair<K, V> {
+    using Pair<K, V>::Pair;
+};
+
+template<typename K, typename V>
+struct AugmentedPair<K, V, OrderStatistics> : Pair<K, V> {
+    using Pair<K, V>::Pair;
+
+    std::size_t size = 1;
+
+    static std::size_t sizeOf(const Pair<K, V>* node) {
+        return node ? static_cast<const AugmentedPair*>(node)->size : 0;
+    }
+
+    void pull() {
+        size = 1 + sizeOf(this->left) + sizeOf(this->right);
+    }
+};
+
+template<typename K, typename V, typename Monoid>
+struct AugmentedPair<K, V, Aggregated<Monoid>> : AugmentedPair<K, V, OrderStatistics> {
+    using AugmentedPair<K, V, OrderStatistics>::AugmentedPair;
+
+    typename Monoid::type aggregate = Monoid::lift(this->key, this->value);
+
+    static typename Monoid::type aggregateOf(const Pair<K, V>* node) {
+        return node ? static_cast<const AugmentedPair*>(node)->aggregate : Monoid::identity();
+    }
+
+    void pull() {
+        AugmentedPair<K, V, OrderStatistics>::pull();
+        aggregate = Monoid::combine(
+            Monoid::combine(aggregateOf(this->left), Monoid::lift(this->key, this->value)),
+            aggregateOf(this->right));
+    }
+};
+
+// In-order iterator holding only the current node and a pointer to the
+// tree's root slot, which is what lets --end() find the last element. It
+// allocates nothing and compares in O(1). Elements are handed out as
+// references into the tree, so the value type is the reference pair itself.
+template<typename K, typename V>
+class Iterator {
+private:
+    Pair<K, V>* node = nullptr;
+    Pair<K, V>* const* root = nullptr;
+
+public:
+    using value_type = std::pair<const K&, V&>;
+    using reference = value_type;
+    using pointer = void;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::bidirectional_iterator_tag;
+    using iterator_concept = std::bidirectional_iterator_tag;
+
+    Iterator() = default;
+
+    Iterator(Pair<K, V>* node, Pair<K, V>* const* root) : node(node), root(root) {}
+
+    reference operator*() const {
+        return {node->key, node->value};
+    }
+
+    Iterator& operator++() {
+        node = node->next();
+        return *this;
+    }
+
+    Iterator operator++(int) {
+        Iterator copy = *this;
+        ++*this;
+        return copy;
+    }
+
+    Iterator& operator--() {
+        if (node) {
+            node = node->prev();
+        } else {
+            node = *root;
+            while (node->right) {
+                node = node->right;
+            }
+        }
+        return *this;
+    }
+
+    Iterator operator--(int) {
+        Iterator copy = *this;
+        --*this;
+        return copy;
+    }
+
+    bool operator==(const Iterator& other) const {
+        return node == other.node;
+    }
+};
+
+// Lazy in-order walk over the keys of a half-open interval. The iterator is
+// seeded by a single lower-bound descent and then follows parent links, so
+// reaching the first element costs O(height) and nothing is copied. A
+// reversed walk mirrors the descent instead of reversing a result, so a
+// caller that stops early pays only for the elements it looked at.
+template<typename K, typename V>
+class RangeIterator {
+private:
+    Pair<K, V>* node = nullptr;
+    const K* bound = nullptr;
+    bool reverse = false;
+
+public:
+    using value_type = std::pair<const K&, V&>;
+    using difference_type = std::ptrdiff_t;
+
+    RangeIterator() = default;
+
+    // Forward: keys in [from, to) ascending. Reverse: keys in [to, from)
+    // descending, starting from the greatest key below `from`.
+    RangeIterator(Pair<K, V>* root, const K& from, const K& to, bool reverse)
+        : bound(&to), reverse(reverse) {
+        while (root) {
+            if (reverse ? root->key < from : !(root->key < from)) {
+                node = root;
+                root = reverse ? root->right : root->left;
+            } else {
+                root = reverse ? root->left : root->right;
+            }
+        }
+    }
+
+    value_type operator*() const {
+        return {node->key, node->value};
+    }
+
+    RangeIterator& operator++() {
+        node = reverse ? node->prev() : node->next();
+        return *this;
+    }
+
+    void operator++(int) {
+        ++*this;
+    }
+
+    bool operator==(std::default_sentinel_t) const {
+        if (!node) {
+            return true;
+        }
+        return reverse ? node->key < *bound : !(node->key < *bound);
+    }
+};
+
+// View returned by SearchingTree::range_view. It keeps the bounds the
+// iterators compare against, so it has to outlive them, and it is invalidated
+// by any modification of the tree, like the tree's own iterators.
+template<typename K, typename V>
+class RangeView : public std::ranges::view_interface<RangeView<K, V>> {
+private:
+    Pair<K, V>* root = nullptr;
+    K from{};
+    K to{};
+    bool reverse = false;
+
+public:
+    RangeView() = default;
+
+    RangeView(Pair<K, V>* root, K a, K b)
+        : root(root), from(std::move(a)), to(std::move(b)), reverse(!(from < to)) {}
+
+    RangeIterator<K, V> begin() const {
+        return RangeIterator<K, V>(root, from, to, reverse);
+    }
+
+    std::default_sentinel_t end() const {
+        return std::default_sentinel;
+    }
+};
+
+// Nodes are owned by the tree and obtained from Allocator, rebound to the
+// node type; pass a NodePool to draw them from slabs with free-list reuse.
+template<typename K, typename V, typename Balance = Unbalanced,
+    typename Allocator = std::allocator<std::pair<const K, V>>, typename Augment = NoAugment>
+class SearchingTree {
+private:
+    static constexpr bool balanced = std::is_same_v<Balance, AvlBalanced>;
+    static constexpr bool augmented = !std::is_same_v<Augment, NoAugment>;
+    static constexpr bool aggregated = augmented && !std::is_same_v<Augment, OrderStatistics>;
+
+    using Node = std::conditional_t<augmented, AugmentedPair<K, V, Augment>, Pair<K, V>>;
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+    using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+    Pair<K, V>* root = nullptr;
+    [[no_unique_address]] NodeAllocator allocator;
+
+    template<typename... Args>
+    Pair<K, V>* createNode(Args&&... args) {
+        Node* node = NodeTraits::allocate(allocator, 1);
+        try {
+            NodeTraits::construct(allocator, node, std::forward<Args>(args)...);
+        } catch (...) {
+            NodeTraits::deallocate(allocator, node, 1);
+            throw;
+        }
+        return node;
+    }
+
+    void destroyNode(Pair<K, V>* node) {
+        NodeTraits::destroy(allocator, static_cast<Node*>(node));
+        NodeTraits::deallocate(allocator, static_cast<Node*>(node), 1);
+    }
+
+    // Frees a whole subtree without recursion: left children are rotated up
+    // until the current node has none, then it is released and the walk
+    // continues down its right spine.
+    void destroyTree(Pair<K, V>* node) {
+        while (node) {
+            if (Pair<K, V>* left = node->left) {
+                node->left = left->right;
+                left->right = node;
+                node = left;
+            } else {
+                Pair<K, V>* right = node->right;
+                destroyNode(node);
+                node = right;
+            }
+        }
+    }
+
+    static int height(const Pair<K, V>* node) {
+        return node ? node->height : 0;
+    }
+
+    // Recomputes what a node caches about its subtree from its children.
+    static void update(Pair<K, V>* node) {
+        node->height = 1 + std::max(height(node->left), height(node->right));
+        if constexpr (augmented) {
+            static_cast<Node*>(node)->pull();
+        }
+    }
+
+    static void setLeft(Pair<K, V>* node, Pair<K, V>* child) {
+        node->left = child;
+        if (child) {
+            child->parent = node;
+        }
+    }
+
+    static void setRight(Pair<K, V>* node, Pair<K, V>* child) {
+        node->right = child;
+        if (child) {
+            child->parent = node;
+        }
+    }
+
+    static Pair<K, V>* rotateRight(Pair<K, V>* node) {
+        Pair<K, V>* left = node->left;
+        left->parent = node->parent;
+        setLeft(node, left->right);
+        update(node);
+        setRight(left, node);
+        update(left);
+        return left;
+    }
+
+    static Pair<K, V>* rotateLeft(Pair<K, V>* node) {
+        Pair<K, V>* right = node->right;
+        right->parent = node->parent;
+        setRight(node, right->left);
+        update(node);
+        setLeft(right, node);
+        update(right);
+        return right;
+    }
+
+    // Restores the AVL invariant at `node` after one of its subtrees changed
+    // height by at most one and refreshes its augmentation. A no-op for an
+    // unbalanced, unaugmented tree.
+    static Pair<K, V>* rebalance(Pair<K, V>* node) {
+        if constexpr (balanced || augmented) {
+            update(node);
+        }
+        if constexpr (balanced) {
+            int factor = height(node->left) - height(node->right);
+            if (factor > 1) {
+                if (height(node->left->left) < height(node->left->right)) {
+                    setLeft(node, rotateLeft(node->left));
+                }
+                return rotateRight(node);
+            }
+            if (factor < -1) {
+                if (height(node->right->right) < height(node->right->left)) {
+                    setRight(node, rotateRight(node->right));
+                }
+                return rotateLeft(node);
+            }
+        }
+        return node;
+    }
+
+    // Walks up from `node` after the subtree below it changed, refreshing
+    // heights and augmentation and rotating wherever the AVL invariant broke.
+    // Unbalanced, unaugmented trees have nothing to restore.
+    void rebalanceUp(Pair<K, V>* node) {
+        if constexpr (balanced || augmented) {
+            while (node) {
+                Pair<K, V>* parent = node->parent;
+                Pair<K, V>* subtree = rebalance(node);
+                if (!parent) {
+                    root = subtree;
+                } else if (parent->left == node) {
+                    parent->left = subtree;
+                } else {
+                    parent->right = subtree;
+                }
+                node = parent;
+            }
+        }
+    }
+
+    // Keys need not be K: anything ordered against K with operator< works,
+    // such as std::string_view against std::string.
+    template<typename Key>
+    static constexpr bool comparable = requires(const Key& key, const K& node) {
+        { key < node } -> std::convertible_to<bool>;
+        { node < key } -> std::convertible_to<bool>;
+    };
+
+    // Descends towards `key`. Returns the node holding it, or nullptr with
+    // `parent` and `slot` describing where a new node would be attached.
+    template<typename Key>
+    Pair<K, V>* findSlot(const Key& key, Pair<K, V>*& parent, Pair<K, V>**& slot) {
+        parent = nullptr;
+        slot = &root;
+        while (*slot) {
+            if (key < (*slot)->key) {
+                parent = *slot;
+                slot = &parent->left;
+            } else if ((*slot)->key < key) {
+                parent = *slot;
+                slot = &parent->right;
+            } else {
+                return *slot;
+            }
+        }
+        return nullptr;
+    }
+
+    void linkNode(Pair<K, V>* node, Pair<K, V>* parent, Pair<K, V>** slot) {
+        node->parent = parent;
+        *slot = node;
+        rebalanceUp(parent);
+    }
+
+    Pair<K, V>* eraseNode(Pair<K, V>* node, const K& key) {
+        if (!node) {
+            return nullptr;
+        } 
+
+        if (key < node->key) {
+            setLeft(node, eraseNode(node->left, key));
+        } else if (key > node->key) {
+            setRight(node, eraseNode(node->right, key));
+        } else {
+            if (!node->left || !node->right) {
+                Pair<K, V>* child = node->left ? node->left : node->right;
+                destroyNode(node);
+                return child;
+            }
+
+            // The successor takes the erased node's place, so no other node's
+            // key or value moves and pointers to them stay valid.
+            Pair<K, V>* successor;
+            Pair<K, V>* right = detachMin(node->right, successor);
+            setLeft(successor, node->left);
+            setRight(successor, right);
+            destroyNode(node);
+            return rebalance(successor);
+        }
+        return rebalance(node);
+    }
+
+    // Unlinks the smallest node of the subtree at `node` into `min` and
+    // returns the rest of the subtree, rebalanced.
+    static Pair<K, V>* detachMin(Pair<K, V>* node, Pair<K, V>*& min) {
+        if (!node->left) {
+            min = node;
+            return node->right;
+        }
+        setLeft(node, detachMin(node->left, min));
+        return rebalance(node);
+    }
+
+    // Links nodes, already in ascending key order, into a perfectly balanced
+    // subtree and returns its root. Balanced for either policy; the recursion
+    // is only log2(n) deep.
+    static Pair<K, V>* linkBalanced(const std::vector<Pair<K, V>*>& nodes, std::size_t first, std::size_t last) {
+        if (first == last) {
+            return nullptr;
+        }
+        std::size_t middle = first + (last - first) / 2;
+        Pair<K, V>* node = nodes[middle];
+        node->parent = nullptr;
+        setLeft(node, linkBalanced(nodes, first, middle));
+        setRight(node, linkBalanced(nodes, middle + 1, last));
+        update(node);
+        return node;
+    }
+
+    Pair<K, V>* findMinNode(Pair<K, V>* node) const {
+        while (node->left) {
+            node = node->left;
+        }
+        return node;
+    }
+
+    template<typename Key>
+    Pair<K, V>* findNode(const Key& key) const {
+        Pair<K, V>* node = root;
+        while (node) {
+            if (key < node->key) {
+                node = node->left;
+            } else if (node->key < key) {
+                node = node->right;
+            } else {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+public:
+    SearchingTree() = default;
+
+    explicit SearchingTree(const Allocator& allocator) : allocator(allocator) {}
+
+    SearchingTree(const SearchingTree&) = delete;
+    SearchingTree& operator=(const SearchingTree&) = delete;
+
+    SearchingTree(SearchingTree&& other) noexcept
+        : root(std::exchange(other.root, nullptr)), allocator(std::move(other.allocator)) {}
+
+    SearchingTree& operator=(SearchingTree&& other) noexcept {
+        std::swap(root, other.root);
+        std::swap(allocator, other.allocator);
+        return *this;
+    }
+
+    ~SearchingTree() {
+        destroyTree(root);
+    }
+
+    void insert(const K& key, const V& value) {
+        try_emplace(key, value);
+    }
+
+    // Like std::map::try_emplace: the value is built from `args` only if the
+    // key is absent, and an existing entry is left untouched.
+    template<typename KeyArg, typename... Args>
+        requires std::constructible_from<K, KeyArg&&> && comparable<std::remove_cvref_t<KeyArg>>
+    std::pair<Iterator<K, V>, bool> try_emplace(KeyArg&& key, Args&&... args) {
+        Pair<K, V>* parent;
+        Pair<K, V>** slot;
+        if (Pair<K, V>* found = findSlot(key, parent, slot)) {
+            return {Iterator<K, V>(found, &root), false};
+        }
+        Pair<K, V>* node = createNode(std::in_place, std::forward<KeyArg>(key), std::forward<Args>(args)...);
+        linkNode(node, parent, slot);
+        return {Iterator<K, V>(node, &root), true};
+    }
+
+    // Builds the node from forwarded key and value arguments first, then
+    // links it in, or discards it if the key is already present.
+    template<typename KeyArg, typename... Args>
+    std::pair<Iterator<K, V>, bool> emplace(KeyArg&& key, Args&&... args) {
+        Pair<K, V>* node = createNode(std::in_place, std::forward<KeyArg>(key), std::forward<Args>(args)...);
+        Pair<K, V>* parent;
+        Pair<K, V>** slot;
+        if (Pair<K, V>* found = findSlot(node->key, parent, slot)) {
+            destroyNode(node);
+            return {Iterator<K, V>(found, &root), false};
+        }
+        linkNode(node, parent, slot);
+        return {Iterator<K, V>(node, &root), true};
+    }
+
+    // Builds a perfectly balanced tree in O(n) from pairs sorted by key.
+    // Equal neighbours keep the first one, as repeated insert() would; keys
+    // out of order are rejected.
+    template<std::ranges::input_range Range>
+    static SearchingTree from_sorted(const Range& pairs, const Allocator& allocator = Allocator()) {
+        SearchingTree tree(allocator);
+        std::vector<Pair<K, V>*> nodes;
+        if constexpr (std::ranges::sized_range<Range>) {
+            nodes.reserve(std::ranges::size(pairs));
+        }
+        try {
+            for (const auto& [key, value] : pairs) {
+                if (!nodes.empty()) {
+                    if (key < nodes.back()->key) {
+                        throw std::invalid_argument("from_sorted: keys are not sorted\n");
+                    }
+                    if (!(nodes.back()->key < key)) {
+                        continue;
+                    }
+                }
+                nodes.push_back(tree.createNode(key, value));
+            }
+        } catch (...) {
+            for (Pair<K, V>* node : nodes) {
+                tree.destroyNode(node);
+            }
+            throw;
+        }
+        tree.root = linkBalanced(nodes, 0, nodes.size());
+        return tree;
+    }
+
+    // Sorts the batch, merges it with the existing keys in one in-order pass
+    // and relinks everything as a perfectly balanced tree, so the cost is
+    // O(m log m + n) instead of m root-to-leaf walks. Keys already present
+    // keep their value, and so do the first of equal keys in the batch.
+    template<std::ranges::input_range Range>
+    void insert_many(const Range& pairs) {
+        std::vector<std::pair<K, V>> batch;
+        if constexpr (std::ranges::sized_range<Range>) {
+            batch.reserve(std::ranges::size(pairs));
+        }
+        for (const auto& [key, value] : pairs) {
+            batch.emplace_back(key, value);
+        }
+        std::stable_sort(batch.begin(), batch.end(), [](const auto& l, const auto& r) {
+            return l.first < r.first;
+        });
+
+        std::vector<Pair<K, V>*> nodes;
+        Pair<K, V>* existing = root ? findMinNode(root) : nullptr;
+        try {
+            for (const auto& [key, value] : batch) {
+                while (existing && existing->key < key) {
+                    nodes.push_back(existing);
+                    existing = existing->next();
+                }
+                bool present = existing && !(key < existing->key);
+                bool repeated = !nodes.empty() && !(nodes.back()->key < key);
+                if (!present && !repeated) {
+                    nodes.push_back(createNode(key, value));
+                }
+            }
+        } catch (...) {
+            // Nothing has been relinked yet: the fresh nodes are the only
+            // ones without a parent, apart from the root.
+            for (Pair<K, V>* node : nodes) {
+                if (node != root && !node->parent) {
+                    destroyNode(node);
+                }
+            }
+            throw;
+        }
+        for (; existing; existing = existing->next()) {
+            nodes.push_back(existing);
+        }
+        root = linkBalanced(nodes, 0, nodes.size());
+    }
+
+    void erase(const K &key) {
+        root = eraseNode(root, key);
+        if (root) {
+            root->parent = nullptr;
+        }
+    }
+
+    std::optional<std::pair<K, V>> find(const K& key) const {
+        Pair<K, V>* node = findNode(key);
+        if (node) {
+            return std::make_pair(node->key, node->value);
+        }
+        return std::nullopt;
+    }
+
+    // Lookups that copy nothing. The key may be any type comparable with K,
+    // so SearchingTree<std::string, V> can be queried with a string_view.
+    template<typename Key> requires comparable<Key>
+    V* get(const Key& key) {
+        Pair<K, V>* node = findNode(key);
+        return node ? &node->value : nullptr;
+    }
+
+    template<typename Key> requires comparable<Key>
+    const V* get(const Key& key) const {
+        Pair<K, V>* node = findNode(key);
+        return node ? &node->value : nullptr;
+    }
+
+    // Iterator to the entry for `key`, or end().
+    template<typename Key> requires comparable<Key>
+    Iterator<K, V> locate(const Key& key) const {
+        return Iterator<K, V>(findNode(key), &root);
+    }
+
+    template<typename Key> requires comparable<Key>
+    bool contains(const Key& key) const {
+        return findNode(key) != nullptr;
+    }
+
+    // Replaces the value stored for `key`, keeping any augmentation up to
+    // date. Returns false if the key is absent.
+    template<typename Key, typename Value> requires comparable<Key>
+    bool assign(const Key& key, Value&& value) {
+        Pair<K, V>* node = findNode(key);
+        if (!node) {
+            return false;
+        }
+        node->value = std::forward<Value>(value);
+        if constexpr (aggregated) {
+            for (; node; node = node->parent) {
+                update(node);
+            }
+        }
+        return true;
+    }
+
+    std::size_t size() const requires augmented {
+        return Node::sizeOf(root);
+    }
+
+    // Number of keys less than `key`.
+    template<typename Key> requires augmented && comparable<Key>
+    std::size_t rank(const Key& key) const {
+        std::size_t result = 0;
+        for (Pair<K, V>* node = root; node;) {
+            if (node->key < key) {
+                result += Node::sizeOf(node->left) + 1;
+                node = node->right;
+            } else {
+                node = node->left;
+            }
+        }
+        return result;
+    }
+
+    // Iterator to the entry with `index` smaller keys, or end().
+    Iterator<K, V> select(std::size_t index) const requires augmented {
+        Pair<K, V>* node = root;
+        while (node) {
+            std::size_t left = Node::sizeOf(node->left);
+            if (index < left) {
+                node = node->left;
+            } else if (index > left) {
+                index -= left + 1;
+                node = node->right;
+            } else {
+                break;
+            }
+        }
+        return Iterator<K, V>(node, &root);
+    }
+
+    // Number of keys in [a, b).
+    template<typename Key> requires augmented && comparable<Key>
+    std::size_t count(const Key& a, const Key& b) const {
+        return a < b ? rank(b) - rank(a) : 0;
+    }
+
+    // Fold under the monoid of the entries with keys in [a, b), in key order:
+    // subtrees entirely inside the interval contribute their cached value,
+    // so only the two boundary paths are visited.
+    template<typename Key> requires aggregated && comparable<Key>
+    auto aggregate(const Key& a, const Key& b) const {
+        using Monoid = typename Augment::monoid;
+        if (!(a < b)) {
+            return Monoid::identity();
+        }
+        // Descend to the highest node inside the interval, where the paths
+        // to the two bounds split.
+        Pair<K, V>* node = root;
+        while (node) {
+            if (node->key < a) {
+                node = node->right;
+            } else if (!(node->key < b)) {
+                node = node->left;
+            } else {
+                break;
+            }
+        }
+        if (!node) {
+            return Monoid::identity();
+        }
+
+        typename Monoid::type from = Monoid::identity();
+        for (Pair<K, V>* left = node->left; left;) {
+            if (left->key < a) {
+                left = left->right;
+            } else {
+                from = Monoid::combine(Monoid::lift(left->key, left->value),
+                    Monoid::combine(Node::aggregateOf(left->right), from));
+                left = left->left;
+            }
+        }
+        typename Monoid::type below = Monoid::identity();
+        for (Pair<K, V>* right = node->right; right;) {
+            if (right->key < b) {
+                below = Monoid::combine(Monoid::combine(below, Node::aggregateOf(right->left)),
+                    Monoid::lift(right->key, right->value));
+                right = right->right;
+            } else {
+                right = right->left;
+            }
+        }
+        return Monoid::combine(Monoid::combine(from, Monoid::lift(node->key, node->value)), below);
+    }
+
+    Iterator<K, V> begin() const {
+        return Iterator<K, V>(root ? findMinNode(root) : nullptr, &root);
+    }
+
+    Iterator<K, V> end() const {
+        return Iterator<K, V>(nullptr, &root);
+    }
+
+    // Keys in [a, b) ascending, or in [b, a) descending when a >= b, without
+    // materializing anything. Works with std::ranges algorithms and views.
+    RangeView<K, V> range_view(K a, K b) const {
+        return RangeView<K, V>(root, std::move(a), std::move(b));
+    }
+
+    std::vector<std::pair<K, V>> range(K a, K b) {
+        std::vector<std::pair<K, V>> result;
+        for (auto [key, value] : range_view(std::move(a), std::move(b))) {
+            result.emplace_back(key, value);
+        }
+        return result;
+    }
+
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// On-disk snapshot of an ordered map with trivially copyable keys and values.
+//
+//     header        SnapshotHeader, at offset 0
+//     keys          count * sizeof(K), ascending, at keys_offset
+//     values        count * sizeof(V), in key order, at values_offset
+//
+// Both arrays start on a snapshot_alignment boundary, so a mapping of the
+// file can be used in place. The header records the element sizes and a
+// byte-order mark, and files written by another layout are rejected rather
+// than misread.
+inline constexpr char snapshot_magic[8] = {'S', 'T', 'R', 'E', 'E', 'S', 'N', 'P'};
+inline constexpr std::uint32_t snapshot_version = 1;
+inline constexpr std::uint32_t snapshot_byte_order = 0x01020304;
+inline constexpr std::uint64_t snapshot_alignment = 64;
+
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t key_size;
+    std::uint32_t value_size;
+    std::uint64_t count;
+    std::uint64_t keys_offset;
+    std::uint64_t values_offset;
+};
+
+inline std::uint64_t snapshot_align(std::uint64_t offset) {
+    return (offset + snapshot_alignment - 1) / snapshot_alignment * snapshot_alignment;
+}
+
+// Writes every entry of `tree`, which must iterate in ascending key order
+// (SearchingTree and BPlusTree both do), in two passes: keys, then values.
+// The snapshot is written to `path` + ".tmp" and renamed over `path`, so
+// processes that still map the old file keep reading it undisturbed.
+template<typename K, typename V, typename Tree>
+void write_snapshot(const Tree& tree, const std::string& path) {
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+        "snapshots store keys and values as raw bytes");
+
+    std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("write_snapshot: cannot open " + temporary + "\n");
+    }
+    auto pad = [&out](std::uint64_t offset) {
+        static constexpr char zeros[snapshot_alignment] = {};
+        std::uint64_t position = static_cast<std::uint64_t>(out.tellp());
+        out.write(zeros, static_cast<std::streamsize>(offset - position));
+    };
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+    header.version = snapshot_version;
+    header.byte_order = snapshot_byte_order;
+    header.key_size = sizeof(K);
+    header.value_size = sizeof(V);
+    header.keys_offset = snapshot_align(sizeof(SnapshotHeader));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    pad(header.keys_offset);
+
+    for (const auto& [key, value] : tree) {
+        const K& stored = key;
+        out.write(reinterpret_cast<const char*>(&stored), sizeof(K));
+        ++header.count;
+    }
+    header.values_offset = snapshot_align(header.keys_offset + header.count * sizeof(K));
+    pad(header.values_offset);
+    for (const auto& [key, value] : tree) {
+        const V& stored = value;
+        out.write(reinterpret_cast<const char*>(&stored), sizeof(V));
+    }
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("write_snapshot: failed writing " + temporary + "\n");
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("write_snapshot: cannot replace " + path + "\n");
+    }
+}
+
+// Read-only ordered map served straight from a mapped snapshot file. Opening
+// only validates the header; lookups binary-search the mapped key array, so
+// pages are faulted in on demand and shared with every other process mapping
+// the same file.
+template<typename K, typename V>
+class MappedTree {
+private:
+    void* mapping = nullptr;
+    std::size_t length = 0;
+    const K* keys_begin = nullptr;
+    const V* values_begin = nullptr;
+    std::size_t count = 0;
+
+    std::size_t lowerBound(const K& key) const {
+        return static_cast<std::size_t>(std::lower_bound(keys_begin, keys_begin + count, key) - keys_begin);
+    }
+
+    void release() {
+        if (mapping) {
+            munmap(mapping, length);
+        }
+        mapping = nullptr;
+    }
+
+public:
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+        "snapshots store keys and values as raw bytes");
+
+    explicit MappedTree(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("MappedTree: cannot open " + path + "\n");
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+            close(fd);
+            throw std::invalid_argument("MappedTree: " + path + " is not a snapshot\n");
+        }
+        length = static_cast<std::size_t>(info.st_size);
+        mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            throw std::runtime_error("MappedTree: cannot map " + path + "\n");
+        }
+
+        SnapshotHeader header;
+        std::memcpy(&header, mapping, sizeof(header));
+        bool valid = std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) == 0
+            && header.version == snapshot_version
+            && header.byte_order == snapshot_byte_order
+            && header.key_size == sizeof(K) && header.value_size == sizeof(V)
+            && header.keys_offset % alignof(K) == 0 && header.values_offset % alignof(V) == 0
+            && header.keys_offset <= length && header.count <= (length - header.keys_offset) / sizeof(K)
+            && header.values_offset <= length && header.count <= (length - header.values_offset) / sizeof(V);
+        if (!valid) {
+            release();
+            throw std::invalid_argument("MappedTree: " + path + " has an incompatible snapshot layout\n");
+        }
+        const char* base = static_cast<const char*>(mapping);
+        keys_begin = reinterpret_cast<const K*>(base + header.keys_offset);
+        values_begin = reinterpret_cast<const V*>(base + header.values_offset);
+        count = static_cast<std::size_t>(header.count);
+    }
+
+    MappedTree(const MappedTree&) = delete;
+    MappedTree& operator=(const MappedTree&) = delete;
+
+    MappedTree(MappedTree&& other) noexcept
+        : mapping(std::exchange(other.mapping, nullptr)), length(other.length),
+          keys_begin(other.keys_begin), values_begin(other.values_begin), count(std::exchange(other.count, 0)) {}
+
+    MappedTree& operator=(MappedTree&& other) noexcept {
+        std::swap(mapping, other.mapping);
+        std::swap(length, other.length);
+        std::swap(keys_begin, other.keys_begin);
+        std::swap(values_begin, other.values_begin);
+        std::swap(count, other.count);
+        return *this;
+    }
+
+    ~MappedTree() {
+        release();
+    }
+
+    std::size_t size() const {
+        return count;
+    }
+
+    std::span<const K> keys() const {
+        return {keys_begin, count};
+    }
+
+    std::span<const V> values() const {
+        return {values_begin, count};
+    }
+
+    const V* get(const K& key) const {
+        std::size_t index = lowerBound(key);
+        if (index < count && !(key < keys_begin[index])) {
+            return values_begin + index;
+        }
+        return nullptr;
+    }
+
+    bool contains(const K& key) const {
+        return get(key) != nullptr;
+    }
+
+    std::optional<std::pair<K, V>> find(const K& key) const {
+        if (const V* value = get(key)) {
+            return std::make_pair(key, *value);
+        }
+        return std::nullopt;
+    }
+
+    // Keys in [a, b) ascending, or in [b, a) descending when a >= b, the
+    // same contract as SearchingTree::range.
+    std::vector<std::pair<K, V>> range(K a, K b) const {
+        std::vector<std::pair<K, V>> result;
+        if (a < b) {
+            for (std::size_t i = lowerBound(a), last = lowerBound(b); i < last; ++i) {
+                result.emplace_back(keys_begin[i], values_begin[i]);
+            }
+        } else {
+            for (std::size_t i = lowerBound(a), first = lowerBound(b); i > first; --i) {
+                result.emplace_back(keys_begin[i - 1], values_begin[i - 1]);
+            }
+        }
+        return result;
+    }
+};
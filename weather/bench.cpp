@@ -0,0 +1,158 @@
+#include "solution.cpp"
+
+#include "benchmark_support/allocation_counter.h"
+
+#include <benchmark/benchmark.h>
+
+#include <streambuf>
+#include <thread>
+
+// Cheap sensors of the three shapes record_sensor distinguishes, so the
+// numbers measure the printers rather than the hardware.
+struct Counter {
+    long measure() {
+        return ++value;
+    }
+
+    long value = 0;
+};
+
+struct Thermometer {
+    double measure() {
+        return 21.5;
+    }
+};
+
+struct WindVane {
+    std::string measure() {
+        return "north-east";
+    }
+};
+
+// Stands in for a probe that waits on I/O.
+struct SlowProbe {
+    int measure() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return 1;
+    }
+};
+
+static SensorRegistrator<Counter> counter("counter");
+static SensorRegistrator<Thermometer> thermometer("temperature");
+static SensorRegistrator<WindVane> wind_vane("wind");
+static SensorRegistrator<SlowProbe> slow_probe("slow");
+
+static const char *sensor_names[] = {"counter", "temperature", "wind"};
+
+// Swallows everything written to it.
+class DiscardBuffer : public std::streambuf {
+protected:
+    std::streamsize xsputn(const char *, std::streamsize count) override {
+        return count;
+    }
+
+    int overflow(int letter) override {
+        return letter;
+    }
+};
+
+static std::unique_ptr<WeatherPrinter> make_chain(std::size_t sensors) {
+    auto &constructor = WeatherPrinterConstructor::get_instance();
+    std::unique_ptr<WeatherPrinter> printer = std::make_unique<WeatherPrinter>();
+    for (std::size_t i = 0; i < sensors; ++i) {
+        printer = constructor.add_sensor(std::move(printer), sensor_names[i % 3]);
+    }
+    return printer;
+}
+
+static std::unique_ptr<WeatherPrinter> make_flat(std::size_t sensors) {
+    auto builder = WeatherPrinterConstructor::get_instance().builder();
+    for (std::size_t i = 0; i < sensors; ++i) {
+        builder.add(sensor_names[i % 3]);
+    }
+    return builder.build();
+}
+
+static void set_sensor_rate(benchmark::State &state) {
+    state.counters["sensors/s"] = benchmark::Counter(static_cast<double>(state.range(0) * state.iterations()),
+        benchmark::Counter::kIsRate);
+}
+
+static void BM_PrintChain(benchmark::State &state) {
+    auto printer = make_chain(state.range(0));
+    DiscardBuffer discard;
+    std::ostream out(&discard);
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        printer->print_to(out);
+    }
+    set_sensor_rate(state);
+}
+BENCHMARK(BM_PrintChain)->RangeMultiplier(10)->Range(1, 10000);
+
+static void BM_PrintFlat(benchmark::State &state) {
+    auto printer = make_flat(state.range(0));
+    DiscardBuffer discard;
+    std::ostream out(&discard);
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        printer->print_to(out);
+    }
+    set_sensor_rate(state);
+}
+BENCHMARK(BM_PrintFlat)->RangeMultiplier(10)->Range(1, 10000);
+
+static void BM_BuildChain(benchmark::State &state) {
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(make_chain(state.range(0)));
+    }
+    set_sensor_rate(state);
+}
+BENCHMARK(BM_BuildChain)->RangeMultiplier(10)->Range(1, 10000);
+
+static void BM_RenderJsonLines(benchmark::State &state) {
+    auto printer = make_chain(state.range(0));
+    DiscardBuffer discard;
+    std::ostream out(&discard);
+    JsonLinesSink sink(out);
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        WeatherPrinterConstructor::render(*printer, sink);
+    }
+    set_sensor_rate(state);
+}
+BENCHMARK(BM_RenderJsonLines)->RangeMultiplier(10)->Range(1, 10000);
+
+static void BM_RenderBinary(benchmark::State &state) {
+    auto printer = make_chain(state.range(0));
+    BinarySink sink;
+    AllocationScope allocations(state);
+    for (auto _ : state) {
+        sink.clear();
+        WeatherPrinterConstructor::render(*printer, sink);
+        benchmark::DoNotOptimize(sink.data().data());
+    }
+    set_sensor_rate(state);
+}
+BENCHMARK(BM_RenderBinary)->RangeMultiplier(10)->Range(1, 10000);
+
+// Up to far more 5 ms probes than cores: each report should still take
+// about 5 ms, since every probe gets a worker of its own.
+static void BM_PrintParallelSlow(benchmark::State &state) {
+    auto &constructor = WeatherPrinterConstructor::get_instance();
+    std::unique_ptr<WeatherPrinter> chain = std::make_unique<WeatherPrinter>();
+    for (long i = 0; i < state.range(0); ++i) {
+        chain = constructor.add_sensor(std::move(chain), "slow");
+    }
+    auto printer = constructor.make_parallel(std::move(chain), std::chrono::milliseconds(1000));
+    DiscardBuffer discard;
+    std::ostream out(&discard);
+    for (auto _ : state) {
+        printer->print_to(out);
+    }
+    set_sensor_rate(state);
+}
+BENCHMARK(BM_PrintParallelSlow)->RangeMultiplier(4)->Range(1, 256)->UseRealTime();
+
+BENCHMARK_MAIN();
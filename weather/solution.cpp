@@ -1,64 +1,973 @@
 #include "solution.h"
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <new>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+// Appends `value` as `out << value` would print it with default formatting.
+// Numbers and strings skip the stream; anything else goes through a reused
+// string stream.
+template<class T>
+static void append_formatted(std::string &buffer, const T &value) {
+    if constexpr (std::is_same_v<T, bool>) {
+        buffer += value ? '1' : '0';
+    } else if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>) {
+        buffer += static_cast<char>(value);
+    } else if constexpr (std::is_arithmetic_v<T>) {
+        char digits[64];
+        std::to_chars_result result;
+        if constexpr (std::is_floating_point_v<T>) {
+            result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::general, 6);
+        } else {
+            result = std::to_chars(digits, digits + sizeof(digits), value);
+        }
+        buffer.append(digits, result.ptr);
+    } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+        buffer += std::string_view(value);
+    } else {
+        thread_local std::ostringstream formatter;
+        formatter.str({});
+        formatter.clear();
+        formatter << value;
+        buffer += formatter.view();
+    }
+}
+
+template<Sensor S>
+static void append_sensor(S &sensor, std::string &buffer) {
+    const auto &value = sensor.measure();
+    append_formatted(buffer, value);
+}
+
+// Hands one measurement to `sink` with the most specific type it has, the
+// text print_to would show being the fallback.
+template<Sensor S>
+static void record_sensor(S &sensor, std::uint32_t id, std::string_view name, MeasurementSink &sink) {
+    const auto &value = sensor.measure();
+    using T = std::decay_t<decltype(value)>;
+    if constexpr (std::is_same_v<T, char> || std::is_same_v<T, signed char> || std::is_same_v<T, unsigned char>) {
+        char letter = static_cast<char>(value);
+        sink.text(id, name, std::string_view(&letter, 1));
+    } else if constexpr (std::is_integral_v<T>) {
+        sink.integer(id, name, static_cast<std::int64_t>(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        sink.real(id, name, static_cast<double>(value));
+    } else if constexpr (std::is_convertible_v<const T &, std::string_view>) {
+        sink.text(id, name, std::string_view(value));
+    } else {
+        thread_local std::string text;
+        text.clear();
+        append_formatted(text, value);
+        sink.text(id, name, text);
+    }
+}
+
 WeatherPrinterConstructor &WeatherPrinterConstructor::get_instance() 
 {
     static WeatherPrinterConstructor instance;
     return instance;
 }
 
+WeatherPrinterConstructor::WeatherPrinterConstructor()
+{
+    rehash(16);
+}
+
+const WeatherPrinterConstructor::SensorHandle *WeatherPrinterConstructor::lookup(const Registry &registry,
+    std::string_view sensor_name)
+{
+    for (std::size_t i = std::hash<std::string_view>()(sensor_name) & registry.mask;; i = (i + 1) & registry.mask) {
+        const SensorHandle *handle = registry.slots[i].load(std::memory_order_acquire);
+        if (!handle || handle->name() == sensor_name) {
+            return handle;
+        }
+    }
+}
+
+void WeatherPrinterConstructor::link(const Registry &registry, const SensorHandle *handle)
+{
+    std::size_t i = std::hash<std::string_view>()(handle->name()) & registry.mask;
+    while (registry.slots[i].load(std::memory_order_relaxed)) {
+        i = (i + 1) & registry.mask;
+    }
+    registry.slots[i].store(handle, std::memory_order_release);
+}
+
+void WeatherPrinterConstructor::rehash(std::size_t capacity)
+{
+    auto next = std::make_unique<const Registry>(capacity);
+    for (const auto &handle : handles) {
+        link(*next, handle.get());
+    }
+    tables.push_back(std::move(next));
+    creators_map.store(tables.back().get(), std::memory_order_release);
+}
+
+WeatherPrinterConstructor::SensorHandle WeatherPrinterConstructor::find_sensor(std::string_view sensor_name) const
+{
+    const SensorHandle *handle = lookup(*creators_map.load(std::memory_order_acquire), sensor_name);
+    if (!handle) {
+        throw std::invalid_argument(std::string(sensor_name) + "is not registered\n");
+    }
+    return *handle;
+}
+
+void WeatherPrinterConstructor::add_sensor_type(std::string sensor_name, const SensorType &type)
+{
+    std::lock_guard<std::mutex> lock(registration);
+    if (sealed.load()) {
+        throw std::logic_error(sensor_name + " registered after the registry was sealed\n");
+    }
+    const Registry &current = *creators_map.load(std::memory_order_relaxed);
+    if (const SensorHandle *existing = lookup(current, sensor_name)) {
+        if (existing->type != &type) {
+            throw std::invalid_argument("Another" + sensor_name + " is already registered\n");
+        }
+        return;
+    }
+
+    auto id = static_cast<std::uint32_t>(names.size());
+    const std::string &name = names.emplace_back(std::move(sensor_name));
+    const SensorHandle *handle = handles.emplace_back(new SensorHandle(name, type, id)).get();
+    if (2 * handles.size() > current.mask + 1) {
+        rehash(2 * (current.mask + 1));
+    } else {
+        link(current, handle);
+    }
+}
+
+std::unique_ptr<WeatherPrinter> WeatherPrinterConstructor::add_sensor(std::unique_ptr<WeatherPrinter> printer,
+    std::string_view sensor_name) 
+{
+    return add_sensor(std::move(printer), find_sensor(sensor_name));
+}
+
 std::unique_ptr<WeatherPrinter> WeatherPrinterConstructor::add_sensor(std::unique_ptr<WeatherPrinter> printer,
-    const std::string &sensor_name) 
+    SensorHandle sensor)
 {
     if (!printer) {
         throw std::invalid_argument("Invalid argument\n");
     }
+    return sensor.type->create_decorator(sensor, std::move(printer));
+}
+
+WeatherPrinterConstructor::SensorHandle WeatherPrinterConstructor::resolve(std::string_view sensor_name) const
+{
+    return find_sensor(sensor_name);
+}
 
-    auto it = creators_map.find(sensor_name);
-    if (it == creators_map.end()) {
-        throw std::invalid_argument(sensor_name + "is not registered\n");
+void WeatherPrinterConstructor::seal()
+{
+    std::lock_guard<std::mutex> lock(registration);
+    if (!sealed.exchange(true)) {
+        // The set is final, so trade memory for shorter probes: at most a
+        // quarter of the slots stay in use.
+        rehash(std::bit_ceil(std::max<std::size_t>(4 * handles.size(), 16)));
     }
-    return it->second(sensor_name, std::move(printer));
+}
 
+bool WeatherPrinterConstructor::is_sealed() const
+{
+    return sealed.load();
 }
 
 template<Sensor S>
-std::unique_ptr<WeatherPrinter> WeatherPrinterConstructor::create_decorator(const std::string &name,
+std::unique_ptr<WeatherPrinter> WeatherPrinterConstructor::create_decorator(const SensorHandle &sensor,
     std::unique_ptr<WeatherPrinter> prev) 
 {
-    return std::make_unique<WeatherPrinterDecorator<S>>(name, std::move(prev));
+    return std::make_unique<WeatherPrinterDecorator<S>>(sensor.name(), sensor.id(), std::move(prev));
 }
 
 template<Sensor S>
+static constexpr double (*sample_function())(void *) {
+    if constexpr (std::is_arithmetic_v<std::decay_t<decltype(std::declval<S &>().measure())>>) {
+        return [](void *sensor) {
+            return static_cast<double>(static_cast<S *>(sensor)->measure());
+        };
+    } else {
+        return nullptr;
+    }
+}
+
+// Constant-initialized, so a printer built by a static initializer in any
+// translation unit already sees the complete table.
+template<Sensor S>
+constinit const WeatherPrinterConstructor::SensorType WeatherPrinterConstructor::sensor_type = {
+    &create_decorator<S>,
+    sizeof(S),
+    alignof(S),
+    [](void *place, const std::string &name) {
+        ::new (place) S(construct_sensor<S>(name));
+    },
+    [](void *sensor) {
+        static_cast<S *>(sensor)->~S();
+    },
+    [](void *sensor, std::string &buffer) {
+        append_sensor(*static_cast<S *>(sensor), buffer);
+    },
+    [](void *sensor, std::uint32_t id, std::string_view name, MeasurementSink &sink) {
+        record_sensor(*static_cast<S *>(sensor), id, name, sink);
+    },
+    sample_function<S>(),
+};
+
+template<Sensor S, class Instrumentation>
 void WeatherPrinterConstructor::register_sensor(std::string sensor_name) 
 {
-    auto &current_creator = creators_map[std::move(sensor_name)];
-    auto creator = &create_decorator<S>;
+    add_sensor_type(std::move(sensor_name), sensor_type<typename Instrumentation::template sensor<S>>);
+}
 
-    if (current_creator && current_creator != creator) {
-        throw std::invalid_argument("Another" + sensor_name + " is already registered\n");
+// Unlinks the chain one printer at a time, so destroying it does not recurse
+// once per sensor either.
+WeatherPrinterConstructor::SensorPrinter::~SensorPrinter() {
+    std::unique_ptr<WeatherPrinter> next = std::move(prev);
+    while (auto *link = dynamic_cast<SensorPrinter *>(next.get())) {
+        next = std::move(link->prev);
     }
+}
+
+WeatherPrinter *WeatherPrinterConstructor::SensorPrinter::collect_chain() {
+    chain.clear();
+    WeatherPrinter *base = nullptr;
+    for (SensorPrinter *link = this; link;) {
+        chain.push_back(link);
+        base = link->prev.get();
+        link = dynamic_cast<SensorPrinter *>(base);
+    }
+    return base;
+}
+
+void WeatherPrinterConstructor::SensorPrinter::print_to(std::ostream &stream) {
+    WeatherPrinter *base = collect_chain();
+    if (base) {
+        base->print_to(stream);
+    }
+
+    buffer.clear();
+    for (auto link = chain.rbegin(); link != chain.rend(); ++link) {
+        buffer += (*link)->name;
+        buffer += ": ";
+        (*link)->append_measurement(buffer);
+        buffer += '\n';
+    }
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
 
-    if (current_creator != creator) {
-        current_creator = creator;
+void WeatherPrinterConstructor::SensorPrinter::render_to(MeasurementSink &sink) {
+    collect_chain();
+    sink.begin();
+    for (auto link = chain.rbegin(); link != chain.rend(); ++link) {
+        (*link)->record_measurement((*link)->id, (*link)->name, sink);
     }
+    sink.end();
+}
+
+void WeatherPrinterConstructor::render(WeatherPrinter &printer, MeasurementSink &sink) {
+    auto *renderable = dynamic_cast<SinkPrinter *>(&printer);
+    if (!renderable) {
+        throw std::invalid_argument("Printer cannot render to a sink\n");
+    }
+    renderable->render_to(sink);
+}
+
+std::unique_ptr<WeatherPrinter> WeatherPrinterConstructor::make_parallel(std::unique_ptr<WeatherPrinter> printer,
+    std::chrono::milliseconds timeout)
+{
+    if (!printer) {
+        throw std::invalid_argument("Invalid argument\n");
+    }
+    return std::make_unique<ParallelPrinter>(std::move(printer), timeout);
+}
+
+// Runs `task` on a detached worker shared by every ParallelPrinter. An idle
+// worker takes it if there is one; otherwise a new worker is started, so
+// every queued measurement has a thread of its own and a report takes as
+// long as its slowest sensor. A sensor stuck in measure() only holds the
+// worker it is on, which no longer counts as idle and so is never waited
+// for. Workers idle for `keep_alive` exit. The pool is never destroyed, so
+// neither exit nor a printer going away waits for a stuck sensor.
+static void run_on_worker(std::function<void()> task) {
+    struct Pool {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<std::function<void()>> tasks;
+        std::size_t idle = 0;
+    };
+    static constexpr std::chrono::seconds keep_alive{10};
+    static Pool *pool = new Pool;
+
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    pool->tasks.push_back(std::move(task));
+    if (pool->tasks.size() <= pool->idle) {
+        lock.unlock();
+        pool->ready.notify_one();
+        return;
+    }
+    try {
+        std::thread([] {
+            std::unique_lock<std::mutex> lock(pool->mutex);
+            for (;;) {
+                ++pool->idle;
+                bool woken = pool->ready.wait_for(lock, keep_alive, [] { return !pool->tasks.empty(); });
+                --pool->idle;
+                if (!woken) {
+                    return;
+                }
+                std::function<void()> next = std::move(pool->tasks.front());
+                pool->tasks.pop_front();
+                lock.unlock();
+                next();
+                next = nullptr;
+                lock.lock();
+            }
+        }).detach();
+    } catch (...) {
+        pool->tasks.pop_back();
+        throw;
+    }
+}
+
+WeatherPrinterConstructor::ParallelPrinter::ParallelPrinter(std::unique_ptr<WeatherPrinter> &&chain,
+    std::chrono::milliseconds timeout)
+    : timeout(timeout), state(std::make_shared<State>())
+{
+    state->chain = std::move(chain);
+    base = state->chain.get();
+    while (auto *link = dynamic_cast<SensorPrinter *>(base)) {
+        links.push_back(link);
+        base = link->prev.get();
+    }
+    std::reverse(links.begin(), links.end());
+    state->measurements.resize(links.size());
+}
+
+void WeatherPrinterConstructor::ParallelPrinter::print_to(std::ostream &stream) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::vector<Measurement> &measurements = state->measurements;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        for (std::size_t i = 0; i < links.size(); ++i) {
+            Measurement &measurement = measurements[i];
+            measurement.ready = false;
+            if (measurement.busy) {
+                continue;
+            }
+            measurement.busy = true;
+            try {
+                run_on_worker([shared = state, link = links[i], i] {
+                    std::string text;
+                    std::exception_ptr error;
+                    try {
+                        link->append_measurement(text);
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                    std::lock_guard<std::mutex> lock(shared->mutex);
+                    Measurement &measurement = shared->measurements[i];
+                    measurement.text = std::move(text);
+                    measurement.error = std::move(error);
+                    measurement.ready = true;
+                    measurement.busy = false;
+                    shared->done.notify_all();
+                });
+            } catch (...) {
+                measurement.busy = false;
+                throw;
+            }
+        }
+    }
+    if (base) {
+        base->print_to(stream);
+    }
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait_until(lock, deadline, [&measurements] {
+        return std::all_of(measurements.begin(), measurements.end(), [](const Measurement &measurement) {
+            return measurement.ready;
+        });
+    });
+    buffer.clear();
+    for (std::size_t i = 0; i < links.size(); ++i) {
+        Measurement &measurement = measurements[i];
+        if (measurement.ready && measurement.error) {
+            std::rethrow_exception(std::exchange(measurement.error, nullptr));
+        }
+        buffer += links[i]->name;
+        buffer += ": ";
+        buffer += measurement.ready ? std::string_view(measurement.text) : std::string_view("timeout");
+        buffer += '\n';
+    }
+    lock.unlock();
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
 }
 
 template<Sensor S>
-void WeatherPrinterConstructor::WeatherPrinterDecorator<S>::print_to(std::ostream &stream) {
-    if (prev) {
-        prev->print_to(stream);
+void WeatherPrinterConstructor::WeatherPrinterDecorator<S>::append_measurement(std::string &buffer) {
+    append_sensor(sensor, buffer);
+}
+
+template<Sensor S>
+void WeatherPrinterConstructor::WeatherPrinterDecorator<S>::record_measurement(std::uint32_t id,
+    std::string_view name, MeasurementSink &sink)
+{
+    record_sensor(sensor, id, name, sink);
+}
+
+WeatherPrinterConstructor::PrinterBuilder WeatherPrinterConstructor::builder(std::unique_ptr<WeatherPrinter> base)
+{
+    return PrinterBuilder(*this, std::move(base));
+}
+
+WeatherPrinterConstructor::PrinterBuilder &WeatherPrinterConstructor::PrinterBuilder::add(std::string_view sensor_name)
+{
+    return add(owner.resolve(sensor_name));
+}
+
+WeatherPrinterConstructor::PrinterBuilder &WeatherPrinterConstructor::PrinterBuilder::add(SensorHandle sensor)
+{
+    sensors.push_back(sensor);
+    return *this;
+}
+
+std::unique_ptr<WeatherPrinter> WeatherPrinterConstructor::PrinterBuilder::build()
+{
+    return std::make_unique<FlatPrinter>(std::move(base), std::exchange(sensors, {}));
+}
+
+std::unique_ptr<WeatherPrinterConstructor::Sampler>
+WeatherPrinterConstructor::PrinterBuilder::build_sampler(std::size_t capacity, SampleSink &sink)
+{
+    return std::make_unique<Sampler>(std::exchange(sensors, {}), capacity, sink);
+}
+
+WeatherPrinterConstructor::SensorStore::SensorStore(std::vector<SensorHandle> sensors)
+    : sensors(std::move(sensors))
+{
+    offsets.reserve(this->sensors.size());
+    std::size_t size = 0;
+    for (const SensorHandle &sensor : this->sensors) {
+        std::size_t offset = (size + sensor.type->align - 1) / sensor.type->align * sensor.type->align;
+        offsets.push_back(offset);
+        size = offset + sensor.type->size;
+        align = std::max(align, sensor.type->align);
     }
-    std::cout << name << ": " << sensor.measure() << "\n";
+
+    storage = static_cast<std::byte *>(::operator new(std::max<std::size_t>(size, 1), std::align_val_t(align)));
+    std::size_t built = 0;
+    try {
+        for (; built < this->sensors.size(); ++built) {
+            this->sensors[built].type->construct(get(built), this->sensors[built].name());
+        }
+    } catch (...) {
+        while (built > 0) {
+            --built;
+            this->sensors[built].type->destroy(get(built));
+        }
+        ::operator delete(storage, std::align_val_t(align));
+        throw;
+    }
+}
+
+WeatherPrinterConstructor::SensorStore::~SensorStore() {
+    for (std::size_t i = sensors.size(); i > 0; --i) {
+        sensors[i - 1].type->destroy(get(i - 1));
+    }
+    ::operator delete(storage, std::align_val_t(align));
+}
+
+void WeatherPrinterConstructor::FlatPrinter::print_to(std::ostream &stream) {
+    if (base) {
+        base->print_to(stream);
+    }
+    buffer.clear();
+    for (std::size_t i = 0; i < store.size(); ++i) {
+        const SensorHandle &sensor = store.handle(i);
+        buffer += sensor.name();
+        buffer += ": ";
+        sensor.type->append_measurement(store.get(i), buffer);
+        buffer += '\n';
+    }
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
 }
 
+void WeatherPrinterConstructor::FlatPrinter::render_to(MeasurementSink &sink) {
+    sink.begin();
+    for (std::size_t i = 0; i < store.size(); ++i) {
+        const SensorHandle &sensor = store.handle(i);
+        sensor.type->record(store.get(i), sensor.id(), sensor.name(), sink);
+    }
+    sink.end();
+}
+
+WeatherPrinterConstructor::Sampler::Sampler(std::vector<SensorHandle> &&sensors, std::size_t capacity,
+    SampleSink &sink)
+    : store(std::move(sensors)), capacity(capacity), sink(sink), times(capacity), values(capacity * store.size())
+{
+    if (capacity == 0) {
+        throw std::invalid_argument("Sampler capacity must be positive\n");
+    }
+    for (const SensorHandle &sensor : store.handles()) {
+        if (!sensor.type->sample) {
+            throw std::invalid_argument(sensor.name() + " does not measure a number\n");
+        }
+    }
+}
+
+WeatherPrinterConstructor::Sampler::~Sampler() {
+    stop();
+}
+
+bool WeatherPrinterConstructor::Sampler::sample() {
+    std::size_t row = head.load(std::memory_order_relaxed);
+    if (row - tail.load(std::memory_order_acquire) == capacity) {
+        dropped_rows.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    std::size_t slot = row % capacity;
+    times[slot] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    for (std::size_t i = 0; i < store.size(); ++i) {
+        double &value = values[i * capacity + slot];
+        try {
+            value = store.handle(i).type->sample(store.get(i));
+        } catch (...) {
+            value = std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+    head.store(row + 1, std::memory_order_release);
+    return true;
+}
+
+std::size_t WeatherPrinterConstructor::Sampler::flush() {
+    std::lock_guard<std::mutex> lock(flushing);
+    std::size_t first = tail.load(std::memory_order_relaxed);
+    std::size_t last = head.load(std::memory_order_acquire);
+    for (std::size_t row = first; row < last;) {
+        std::size_t slot = row % capacity;
+        std::size_t count = std::min(last - row, capacity - slot);
+        sink.consume(SampleBatch{store.handles(), {times.data() + slot, count}, values.data() + slot, capacity});
+        row += count;
+        tail.store(row, std::memory_order_release);
+    }
+    return last - first;
+}
+
+void WeatherPrinterConstructor::Sampler::start(std::chrono::nanoseconds period,
+    std::chrono::milliseconds flush_interval)
+{
+    if (running.exchange(true)) {
+        throw std::logic_error("Sampler is already running\n");
+    }
+    sampler_thread = std::thread([this, period] {
+        auto next = std::chrono::steady_clock::now();
+        while (running.load(std::memory_order_relaxed)) {
+            sample();
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+    });
+    flusher_thread = std::thread([this, flush_interval] {
+        while (running.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(flush_interval);
+            flush();
+        }
+    });
+}
+
+void WeatherPrinterConstructor::Sampler::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    sampler_thread.join();
+    flusher_thread.join();
+    flush();
+}
+
+void TextSink::begin() {
+    buffer.clear();
+}
+
+void TextSink::integer(std::uint32_t, std::string_view name, std::int64_t value) {
+    buffer += name;
+    buffer += ": ";
+    append_formatted(buffer, value);
+    buffer += '\n';
+}
+
+void TextSink::real(std::uint32_t, std::string_view name, double value) {
+    buffer += name;
+    buffer += ": ";
+    append_formatted(buffer, value);
+    buffer += '\n';
+}
+
+void TextSink::text(std::uint32_t, std::string_view name, std::string_view value) {
+    buffer += name;
+    buffer += ": ";
+    buffer += value;
+    buffer += '\n';
+}
+
+void TextSink::end() {
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+// Appends `text` as a quoted JSON string.
+static void append_json_string(std::string &buffer, std::string_view text) {
+    static constexpr char hex[] = "0123456789abcdef";
+    buffer += '"';
+    for (char letter : text) {
+        auto code = static_cast<unsigned char>(letter);
+        if (letter == '"' || letter == '\\') {
+            buffer += '\\';
+            buffer += letter;
+        } else if (letter == '\n') {
+            buffer += "\\n";
+        } else if (letter == '\t') {
+            buffer += "\\t";
+        } else if (code < 0x20) {
+            buffer += "\\u00";
+            buffer += hex[code >> 4];
+            buffer += hex[code & 0xf];
+        } else {
+            buffer += letter;
+        }
+    }
+    buffer += '"';
+}
+
+void JsonLinesSink::begin() {
+    buffer.assign(1, '{');
+}
+
+void JsonLinesSink::append_key(std::string_view name) {
+    if (buffer.size() > 1) {
+        buffer += ',';
+    }
+    append_json_string(buffer, name);
+    buffer += ':';
+}
+
+void JsonLinesSink::integer(std::uint32_t, std::string_view name, std::int64_t value) {
+    append_key(name);
+    append_formatted(buffer, value);
+}
+
+void JsonLinesSink::real(std::uint32_t, std::string_view name, double value) {
+    append_key(name);
+    if (!std::isfinite(value)) {
+        buffer += "null";
+        return;
+    }
+    char digits[64];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+}
+
+void JsonLinesSink::text(std::uint32_t, std::string_view name, std::string_view value) {
+    append_key(name);
+    append_json_string(buffer, value);
+}
+
+void JsonLinesSink::end() {
+    buffer += "}\n";
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+std::int64_t BinaryRecord::integer() const {
+    std::int64_t value = 0;
+    std::memcpy(&value, payload.data(), std::min(payload.size(), sizeof(value)));
+    return value;
+}
+
+double BinaryRecord::real() const {
+    double value = 0;
+    std::memcpy(&value, payload.data(), std::min(payload.size(), sizeof(value)));
+    return value;
+}
+
+static std::size_t binary_padded(std::size_t size) {
+    return (size + 7) / 8 * 8;
+}
+
+BinaryRecords::iterator::iterator(std::span<const std::byte> rest) : rest(rest) {
+    if (rest.empty()) {
+        return;
+    }
+    BinaryRecordHeader header;
+    if (rest.size() < sizeof(header)) {
+        throw std::invalid_argument("Truncated binary record\n");
+    }
+    std::memcpy(&header, rest.data(), sizeof(header));
+    if (header.size > rest.size() - sizeof(header)) {
+        throw std::invalid_argument("Truncated binary record\n");
+    }
+    auto size = static_cast<std::size_t>(header.size);
+    record = BinaryRecord{header.sensor_id, header.kind, rest.subspan(sizeof(header), size)};
+}
+
+BinaryRecords::iterator &BinaryRecords::iterator::operator++() {
+    std::size_t length = sizeof(BinaryRecordHeader) + binary_padded(record.payload.size());
+    *this = iterator(rest.subspan(std::min(length, rest.size())));
+    return *this;
+}
+
+void BinarySink::append(std::uint32_t id, BinaryKind kind, const void *payload, std::size_t size) {
+    BinaryRecordHeader header{id, kind, size};
+    std::size_t start = buffer.size();
+    buffer.resize(start + sizeof(header) + binary_padded(size));
+    std::memcpy(buffer.data() + start, &header, sizeof(header));
+    if (size > 0) {
+        std::memcpy(buffer.data() + start + sizeof(header), payload, size);
+    }
+}
+
+void BinarySink::announce(std::uint32_t id, std::string_view name) {
+    if (id >= named.size()) {
+        named.resize(id + 1);
+    }
+    if (!named[id]) {
+        named[id] = true;
+        append(id, BinaryKind::name, name.data(), name.size());
+    }
+}
+
+void BinarySink::begin() {
+    std::int64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    append(0, BinaryKind::pass, &time, sizeof(time));
+}
+
+void BinarySink::integer(std::uint32_t id, std::string_view name, std::int64_t value) {
+    announce(id, name);
+    append(id, BinaryKind::integer, &value, sizeof(value));
+}
+
+void BinarySink::real(std::uint32_t id, std::string_view name, double value) {
+    announce(id, name);
+    append(id, BinaryKind::real, &value, sizeof(value));
+}
+
+void BinarySink::text(std::uint32_t id, std::string_view name, std::string_view value) {
+    announce(id, name);
+    append(id, BinaryKind::text, value.data(), value.size());
+}
+
+void LatencyRecorder::record(std::chrono::nanoseconds elapsed) {
+    auto nanoseconds = static_cast<std::uint64_t>(std::max<std::int64_t>(elapsed.count(), 0));
+    std::size_t bucket = std::min<std::size_t>(std::bit_width(nanoseconds), LatencyHistogram::bucket_count - 1);
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(static_cast<std::int64_t>(nanoseconds), std::memory_order_relaxed);
+}
+
+LatencyHistogram LatencyRecorder::snapshot() const {
+    LatencyHistogram histogram;
+    for (std::size_t i = 0; i < LatencyHistogram::bucket_count; ++i) {
+        histogram.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    histogram.count = count.load(std::memory_order_relaxed);
+    histogram.total = std::chrono::nanoseconds(total.load(std::memory_order_relaxed));
+    return histogram;
+}
+
+std::shared_ptr<LatencyRecorder> WeatherPrinterConstructor::recorder_for(Recorders &recorders,
+    const std::string &label)
+{
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    auto &recorder = recorders[label];
+    if (!recorder) {
+        recorder = std::make_shared<LatencyRecorder>();
+    }
+    return recorder;
+}
+
+std::unique_ptr<WeatherPrinter> WeatherPrinterConstructor::instrument(std::unique_ptr<WeatherPrinter> printer,
+    std::string label)
+{
+    if (!printer) {
+        throw std::invalid_argument("Invalid argument\n");
+    }
+    return std::make_unique<TimedPrinter>(std::move(printer), recorder_for(print_latencies, label));
+}
+
+void WeatherPrinterConstructor::TimedPrinter::print_to(std::ostream &stream) {
+    auto start = std::chrono::steady_clock::now();
+    printer->print_to(stream);
+    recorder->record(std::chrono::steady_clock::now() - start);
+}
+
+void WeatherPrinterConstructor::TimedPrinter::render_to(MeasurementSink &sink) {
+    auto start = std::chrono::steady_clock::now();
+    render(*printer, sink);
+    recorder->record(std::chrono::steady_clock::now() - start);
+}
+
+WeatherPrinterConstructor::Metrics WeatherPrinterConstructor::metrics() const {
+    Metrics result;
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    for (const auto &[name, recorder] : sensor_latencies) {
+        result.sensors.emplace_back(name, recorder->snapshot());
+    }
+    for (const auto &[label, recorder] : print_latencies) {
+        result.printers.emplace_back(label, recorder->snapshot());
+    }
+    return result;
+}
+
+// Appends `value` as a quoted Prometheus label value.
+static void append_label(std::string &buffer, std::string_view value) {
+    buffer += '"';
+    for (char letter : value) {
+        if (letter == '"' || letter == '\\') {
+            buffer += '\\';
+            buffer += letter;
+        } else if (letter == '\n') {
+            buffer += "\\n";
+        } else {
+            buffer += letter;
+        }
+    }
+    buffer += '"';
+}
+
+static void append_histogram(std::string &buffer, std::string_view metric, std::string_view label,
+    const std::vector<std::pair<std::string, LatencyHistogram>> &histograms)
+{
+    buffer += "# TYPE ";
+    buffer += metric;
+    buffer += " histogram\n";
+    for (const auto &[name, histogram] : histograms) {
+        std::uint64_t cumulative = 0;
+        for (std::size_t i = 0; i < LatencyHistogram::bucket_count; ++i) {
+            cumulative += histogram.buckets[i];
+            buffer += metric;
+            buffer += "_bucket{";
+            buffer += label;
+            buffer += '=';
+            append_label(buffer, name);
+            buffer += ",le=\"";
+            if (i + 1 < LatencyHistogram::bucket_count) {
+                append_formatted(buffer, std::ldexp(1e-9, static_cast<int>(i)));
+            } else {
+                buffer += "+Inf";
+            }
+            buffer += "\"} ";
+            append_formatted(buffer, cumulative);
+            buffer += '\n';
+        }
+        for (std::string_view suffix : {"_sum", "_count"}) {
+            buffer += metric;
+            buffer += suffix;
+            buffer += '{';
+            buffer += label;
+            buffer += '=';
+            append_label(buffer, name);
+            buffer += "} ";
+            if (suffix == "_sum") {
+                append_formatted(buffer, std::chrono::duration<double>(histogram.total).count());
+            } else {
+                append_formatted(buffer, histogram.count);
+            }
+            buffer += '\n';
+        }
+    }
+}
+
+void WeatherPrinterConstructor::write_metrics(std::ostream &stream) const {
+    Metrics snapshot = metrics();
+    std::string buffer;
+    append_histogram(buffer, "weather_sensor_measure_seconds", "sensor", snapshot.sensors);
+    append_histogram(buffer, "weather_print_seconds", "printer", snapshot.printers);
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+template<Sensor... S>
+void SensorTuplePrinter<S...>::print_to(std::ostream &stream) {
+    buffer.clear();
+    std::apply([this](auto &...sensor) {
+        std::size_t index = 0;
+        ((buffer += names[index++], buffer += ": ", append_sensor(sensor, buffer), buffer += '\n'), ...);
+    }, sensors);
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+template<Sensor S, unsigned TtlMs>
+CachedSensor<S, TtlMs>::CachedSensor() : entry(std::make_shared<Entry>()) {}
+
+template<Sensor S, unsigned TtlMs>
+CachedSensor<S, TtlMs>::CachedSensor(named_sensor_tag, const std::string &sensor_name)
+    : entry(entry_for(sensor_name)) {}
+
+template<Sensor S, unsigned TtlMs>
+std::shared_ptr<typename CachedSensor<S, TtlMs>::Entry> CachedSensor<S, TtlMs>::entry_for(const std::string &sensor_name)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<Entry>, std::less<>> entries;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &entry = entries[sensor_name];
+    if (!entry) {
+        entry = std::make_shared<Entry>();
+    }
+    return entry;
+}
+
+template<Sensor S, unsigned TtlMs>
+typename CachedSensor<S, TtlMs>::value_type CachedSensor<S, TtlMs>::measure()
+{
+    constexpr auto ttl = std::chrono::milliseconds(TtlMs);
+    {
+        std::shared_lock<std::shared_mutex> lock(entry->mutex);
+        if (entry->value && std::chrono::steady_clock::now() - entry->taken < ttl) {
+            return *entry->value;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(entry->mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (!entry->value || now - entry->taken >= ttl) {
+        entry->value = entry->sensor.measure();
+        entry->taken = std::chrono::steady_clock::now();
+    }
+    return *entry->value;
+}
+
+template<Sensor S>
+InstrumentedSensor<S>::InstrumentedSensor() : recorder(std::make_shared<LatencyRecorder>()) {}
+
 template<Sensor S>
-std::unique_ptr<WeatherPrinter> WeatherPrinterConstructor::create_decorator(const std::string &name,
-    std::unique_ptr<WeatherPrinter> prev)
+InstrumentedSensor<S>::InstrumentedSensor(named_sensor_tag, const std::string &sensor_name)
+    : sensor(construct_sensor<S>(sensor_name)),
+      recorder(WeatherPrinterConstructor::get_instance().recorder_for(
+          WeatherPrinterConstructor::get_instance().sensor_latencies, sensor_name))
 {
-    return std::make_unique<WeatherPrinterDecorator<S>>(name, std::move(prev));
 }
 
+// A measure() that throws is timed as well.
 template<Sensor S>
-SensorRegistrator<S>::SensorRegistrator(std::string sensor_name) {
-    WeatherPrinterConstructor::get_instance().register_sensor<S>(std::move(sensor_name));
+typename InstrumentedSensor<S>::value_type InstrumentedSensor<S>::measure()
+{
+    auto start = std::chrono::steady_clock::now();
+    try {
+        value_type value = sensor.measure();
+        recorder->record(std::chrono::steady_clock::now() - start);
+        return value;
+    } catch (...) {
+        recorder->record(std::chrono::steady_clock::now() - start);
+        throw;
+    }
+}
+
+template<Sensor S, class Instrumentation>
+SensorRegistrator<S, Instrumentation>::SensorRegistrator(std::string sensor_name) {
+    WeatherPrinterConstructor::get_instance().register_sensor<S, Instrumentation>(std::move(sensor_name));
 }
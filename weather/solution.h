@@ -2,57 +2,803 @@
 
 #include "printer.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
 #include <string>
 #include <map>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <type_traits>
 #include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 template<class T>
 concept Sensor = std::is_default_constructible_v<T> && requires(std::ostream &out, T &x) {
     { out << x.measure() };
 };
 
+// Sensors opt in to being told the name they were registered under with a
+// constructor S(named_sensor_tag, const std::string &), as CachedSensor
+// does; all others are default built, whatever other constructors they have.
+struct named_sensor_tag {
+    explicit named_sensor_tag() = default;
+};
+
+inline constexpr named_sensor_tag named_sensor{};
+
+template<Sensor S>
+S construct_sensor(const std::string &sensor_name) {
+    if constexpr (std::is_constructible_v<S, named_sensor_tag, const std::string &>) {
+        return S(named_sensor, sensor_name);
+    } else {
+        return S();
+    }
+}
+
+class SampleSink;
+
+// Receives a printer's measurements as typed values rather than text; see
+// WeatherPrinterConstructor::render. Every pass is bracketed by begin() and
+// end(). Integral and bool results arrive as integer(), floating point ones
+// as real(), and anything else as the text print_to would show for it.
+// `id` is the sensor's registry id, `name` its registered name.
+class MeasurementSink {
+public:
+    virtual void begin() {}
+
+    virtual void integer(std::uint32_t id, std::string_view name, std::int64_t value) = 0;
+
+    virtual void real(std::uint32_t id, std::string_view name, double value) = 0;
+
+    virtual void text(std::uint32_t id, std::string_view name, std::string_view value) = 0;
+
+    virtual void end() {}
+
+    virtual ~MeasurementSink() {}
+};
+
+// Latencies in power-of-two buckets: buckets[i] counts calls that took
+// less than 2^i ns, and at least 2^(i-1) ns for i > 0. The last bucket also
+// takes everything slower.
+struct LatencyHistogram {
+    static constexpr std::size_t bucket_count = 40;
+
+    std::array<std::uint64_t, bucket_count> buckets{};
+    std::uint64_t count = 0;
+    std::chrono::nanoseconds total{0};
+};
+
+// Live counters behind a LatencyHistogram. record() is three relaxed atomic
+// adds and may be called from any number of threads.
+class LatencyRecorder {
+public:
+    void record(std::chrono::nanoseconds elapsed);
+
+    LatencyHistogram snapshot() const;
+
+private:
+    std::array<std::atomic<std::uint64_t>, LatencyHistogram::bucket_count> buckets{};
+    std::atomic<std::uint64_t> count = 0;
+    std::atomic<std::int64_t> total = 0;
+};
+
+template<Sensor S>
+class InstrumentedSensor;
+
+// Instrumentation policies for register_sensor and SensorRegistrator; each
+// maps a sensor type to the type that is actually registered. The default
+// registers S itself, so uninstrumented sensors carry no timing code at all.
+struct NoInstrumentation {
+    template<Sensor S>
+    using sensor = S;
+};
+
+struct LatencyInstrumentation {
+    template<Sensor S>
+    using sensor = InstrumentedSensor<S>;
+};
+
+// Printer that can hand its sensors' measurements to a MeasurementSink
+// instead of formatting them.
+class SinkPrinter : public WeatherPrinter {
+public:
+    virtual void render_to(MeasurementSink &sink) = 0;
+};
+
 class WeatherPrinterConstructor {
 public:
     WeatherPrinterConstructor(const WeatherPrinterConstructor &) = delete;
 
+    class SensorHandle;
+
+    std::unique_ptr<WeatherPrinter>
+    add_sensor(std::unique_ptr<WeatherPrinter> printer, std::string_view sensor_name);
+
+    // Same as add_sensor by name, without the lookup.
     std::unique_ptr<WeatherPrinter>
-    add_sensor(std::unique_ptr<WeatherPrinter> printer, const std::string &sensor_name);
+    add_sensor(std::unique_ptr<WeatherPrinter> printer, SensorHandle sensor);
 
     static WeatherPrinterConstructor &get_instance();
 
-    template<Sensor S>
-    void register_sensor(std::string sensor_name) {}
+    // Looks a registered name up once; the handle stays valid for the
+    // lifetime of the constructor.
+    SensorHandle resolve(std::string_view sensor_name) const;
+
+    // Ends registration: later register_sensor calls throw. Lookups are
+    // safe on any thread either way; sealing fixes the set of names, e.g.
+    // once static registration is over, and rehashes the registry to a lower
+    // load factor.
+    void seal();
+
+    bool is_sealed() const;
+
+    // Wraps a printer chain so that print_to runs every sensor's measure()
+    // on a worker thread of its own, all at once, and prints the results in
+    // chain order. Idle workers are reused and new ones started when none is
+    // free, so sensors stuck elsewhere never delay a report. A sensor that
+    // has not answered within `timeout`, or is still stuck in the previous
+    // report, is printed as "timeout" instead.
+    std::unique_ptr<WeatherPrinter>
+    make_parallel(std::unique_ptr<WeatherPrinter> printer, std::chrono::milliseconds timeout);
+
+    template<Sensor S, class Instrumentation = NoInstrumentation>
+    void register_sensor(std::string sensor_name);
+
+    class PrinterBuilder;
+    class Sampler;
+
+    // Starts a printer that keeps all of its sensors in one contiguous block
+    // instead of a chain of decorators; see PrinterBuilder.
+    PrinterBuilder builder(std::unique_ptr<WeatherPrinter> base = nullptr);
+
+    // Runs one pass of `printer`'s sensors into `sink`. Works for add_sensor
+    // chains and PrinterBuilder printers; the base printer under them only
+    // knows how to print text and is skipped. Throws for any other printer.
+    static void render(WeatherPrinter &printer, MeasurementSink &sink);
+
+    // Wraps a finished printer so that its print_to and render passes are
+    // timed under `label`. Wrap last: add_sensor and make_parallel treat the
+    // result as an opaque base printer.
+    std::unique_ptr<WeatherPrinter> instrument(std::unique_ptr<WeatherPrinter> printer, std::string label);
+
+    struct Metrics {
+        // measure() per registered name, for LatencyInstrumentation sensors.
+        std::vector<std::pair<std::string, LatencyHistogram>> sensors;
+        // Whole passes per instrument() label.
+        std::vector<std::pair<std::string, LatencyHistogram>> printers;
+    };
+
+    Metrics metrics() const;
+
+    // Writes metrics() in the Prometheus text exposition format.
+    void write_metrics(std::ostream &stream) const;
 
 private:
-    WeatherPrinterConstructor() = default;
+    template<Sensor S>
+    friend class InstrumentedSensor;
+    // What the constructor knows about a registered sensor type: how to wrap
+    // it in a decorator, and how to build, measure and destroy it in place.
+    struct SensorType {
+        std::unique_ptr<WeatherPrinter> (*create_decorator)(const SensorHandle &, std::unique_ptr<WeatherPrinter>);
+        std::size_t size;
+        std::size_t align;
+        void (*construct)(void *, const std::string &);
+        void (*destroy)(void *);
+        void (*append_measurement)(void *, std::string &);
+        void (*record)(void *, std::uint32_t, std::string_view, MeasurementSink &);
+        // Null unless measure() returns an arithmetic type.
+        double (*sample)(void *);
+    };
 
     template<Sensor S>
-    class WeatherPrinterDecorator final : public WeatherPrinter {
+    static const SensorType sensor_type;
 
+    // Sensors of any registered types constructed side by side in one
+    // aligned block, in the order given; shared by FlatPrinter and Sampler.
+    class SensorStore {
     public:
-        WeatherPrinterDecorator(const std::string &name, std::unique_ptr<WeatherPrinter> &&prev)
-            : name(name), prev(std::move(prev)) {
+        explicit SensorStore(std::vector<SensorHandle> sensors);
+
+        SensorStore(const SensorStore &) = delete;
+        SensorStore &operator=(const SensorStore &) = delete;
+
+        ~SensorStore();
+
+        std::size_t size() const {
+            return sensors.size();
         }
 
-        void print_to(std::ostream &stream) override;
+        const SensorHandle &handle(std::size_t index) const {
+            return sensors[index];
+        }
+
+        const std::vector<SensorHandle> &handles() const {
+            return sensors;
+        }
+
+        void *get(std::size_t index) const {
+            return storage + offsets[index];
+        }
 
     private:
+        std::vector<SensorHandle> sensors;
+        std::vector<std::size_t> offsets;
+        std::size_t align = alignof(std::max_align_t);
+        std::byte *storage;
+    };
+
+    WeatherPrinterConstructor();
+
+    class ParallelPrinter;
+
+    // Link of a printer chain. print_to walks the chain iteratively, formats
+    // every sensor line into one reusable buffer, oldest sensor first, and
+    // hands it to the stream in a single write. `name` refers to the registry's
+    // copy of the name, which lives as long as the constructor.
+    class SensorPrinter : public SinkPrinter {
+    public:
+        SensorPrinter(const std::string &name, std::uint32_t id, std::unique_ptr<WeatherPrinter> &&prev)
+            : name(name), id(id), prev(std::move(prev)) {
+        }
+
+        ~SensorPrinter() override;
+
+        void print_to(std::ostream &stream) final;
+
+        void render_to(MeasurementSink &sink) final;
+
+    protected:
+        virtual void append_measurement(std::string &buffer) = 0;
+
+        virtual void record_measurement(std::uint32_t id, std::string_view name, MeasurementSink &sink) = 0;
+
+    private:
+        friend class ParallelPrinter;
+
+        // Fills `chain` with this link and the ones below it, newest first,
+        // and returns the printer at the bottom, if any.
+        WeatherPrinter *collect_chain();
+
         const std::string &name;
+        std::uint32_t id;
         std::unique_ptr<WeatherPrinter> prev;
+        std::vector<SensorPrinter *> chain;
+        std::string buffer;
+    };
+
+    template<Sensor S>
+    class WeatherPrinterDecorator final : public SensorPrinter {
+
+    public:
+        WeatherPrinterDecorator(const std::string &name, std::uint32_t id, std::unique_ptr<WeatherPrinter> &&prev)
+            : SensorPrinter(name, id, std::move(prev)), sensor(construct_sensor<S>(name)) {
+        }
+
+    private:
+        void append_measurement(std::string &buffer) override;
+
+        void record_measurement(std::uint32_t id, std::string_view name, MeasurementSink &sink) override;
+
         S sensor;
     };
 
+    // Printer returned by make_parallel. The chain lives in `state`, which
+    // every queued or running measurement shares, so destroying the printer
+    // never waits: a sensor stuck in measure() keeps its chain alive until
+    // it returns. Each sensor has at most one measurement in flight.
+    class ParallelPrinter final : public WeatherPrinter {
+    public:
+        ParallelPrinter(std::unique_ptr<WeatherPrinter> &&chain, std::chrono::milliseconds timeout);
+
+        void print_to(std::ostream &stream) override;
+
+    private:
+        struct Measurement {
+            bool busy = false;
+            bool ready = false;
+            std::string text;
+            std::exception_ptr error;
+        };
+
+        struct State {
+            std::unique_ptr<WeatherPrinter> chain;
+            std::mutex mutex;
+            std::condition_variable done;
+            std::vector<Measurement> measurements;
+        };
+
+        std::vector<SensorPrinter *> links;
+        WeatherPrinter *base = nullptr;
+        std::chrono::milliseconds timeout;
+        std::shared_ptr<State> state;
+        std::string buffer;
+    };
+
     template<Sensor S>
-    static std::unique_ptr<WeatherPrinter> create_decorator(const std::string &name,
+    static std::unique_ptr<WeatherPrinter> create_decorator(const SensorHandle &sensor,
         std::unique_ptr<WeatherPrinter> prev);
 
-    std::map<std::string, std::unique_ptr<WeatherPrinter>(*)(const std::string &, std::unique_ptr<WeatherPrinter>)>
-    creators_map;
+    // Printer made by PrinterBuilder. Each sensor is reached through its
+    // type's function pointers, so print_to is one loop over the store.
+    class FlatPrinter final : public SinkPrinter {
+    public:
+        FlatPrinter(std::unique_ptr<WeatherPrinter> &&base, std::vector<SensorHandle> &&sensors)
+            : base(std::move(base)), store(std::move(sensors)) {
+        }
+
+        void print_to(std::ostream &stream) override;
+
+        void render_to(MeasurementSink &sink) override;
+
+    private:
+        std::unique_ptr<WeatherPrinter> base;
+        SensorStore store;
+        std::string buffer;
+    };
+
+    // Printer returned by instrument().
+    class TimedPrinter final : public SinkPrinter {
+    public:
+        TimedPrinter(std::unique_ptr<WeatherPrinter> &&printer, std::shared_ptr<LatencyRecorder> &&recorder)
+            : printer(std::move(printer)), recorder(std::move(recorder)) {
+        }
+
+        void print_to(std::ostream &stream) override;
+
+        void render_to(MeasurementSink &sink) override;
+
+    private:
+        std::unique_ptr<WeatherPrinter> printer;
+        std::shared_ptr<LatencyRecorder> recorder;
+    };
+
+    void add_sensor_type(std::string sensor_name, const SensorType &type);
+
+    SensorHandle find_sensor(std::string_view sensor_name) const;
+
+    // The registry is an open-addressed table of handle pointers that is
+    // never more than half full. Readers load the current table and probe it
+    // without locking. A registration, under `registration`, publishes its
+    // handle into a free slot of that table, or into a table of twice the
+    // size when it would pass half full. Old tables are never freed, since a
+    // reader may still be probing one, but their sizes halve going back, so
+    // together they hold fewer slots than the current table. Names and
+    // handles are stored once, in `names` and `handles`, whose elements
+    // never move, so handles and printers can refer to them.
+    struct Registry {
+        explicit Registry(std::size_t capacity)
+            : mask(capacity - 1), slots(std::make_unique<std::atomic<const SensorHandle *>[]>(capacity)) {
+        }
+
+        std::size_t mask;
+        std::unique_ptr<std::atomic<const SensorHandle *>[]> slots;
+    };
+
+    static const SensorHandle *lookup(const Registry &registry, std::string_view sensor_name);
+
+    static void link(const Registry &registry, const SensorHandle *handle);
+
+    // Publishes a table of `capacity` slots holding every handle.
+    void rehash(std::size_t capacity);
+
+    std::atomic<const Registry *> creators_map;
+    std::atomic<bool> sealed = false;
+    std::mutex registration;
+    std::deque<std::string> names;
+    std::deque<std::unique_ptr<const SensorHandle>> handles;
+    std::vector<std::unique_ptr<const Registry>> tables;
+
+    using Recorders = std::map<std::string, std::shared_ptr<LatencyRecorder>, std::less<>>;
+
+    std::shared_ptr<LatencyRecorder> recorder_for(Recorders &recorders, const std::string &label);
+
+    mutable std::mutex metrics_mutex;
+    Recorders sensor_latencies;
+    Recorders print_latencies;
 };
 
+// A registered sensor name resolved to its type, as returned by resolve().
+class WeatherPrinterConstructor::SensorHandle {
+public:
+    const std::string &name() const {
+        return *sensor_name;
+    }
+
+    // Registration order, starting at 0; what binary sinks record instead
+    // of the name.
+    std::uint32_t id() const {
+        return sensor_id;
+    }
+
+private:
+    friend class WeatherPrinterConstructor;
+
+    SensorHandle(const std::string &sensor_name, const SensorType &type, std::uint32_t sensor_id)
+        : sensor_name(&sensor_name), type(&type), sensor_id(sensor_id) {
+    }
+
+    const std::string *sensor_name;
+    const SensorType *type;
+    std::uint32_t sensor_id;
+};
+
+// Collects registered sensor names, oldest first as with add_sensor, and
+// builds them into a single FlatPrinter:
+//
+//     auto printer = WeatherPrinterConstructor::get_instance().builder()
+//         .add("temperature").add("humidity").build();
+class WeatherPrinterConstructor::PrinterBuilder {
+public:
+    PrinterBuilder &add(std::string_view sensor_name);
+
+    PrinterBuilder &add(SensorHandle sensor);
+
+    std::unique_ptr<WeatherPrinter> build();
+
+    // Builds the same sensors into a Sampler instead; see there.
+    std::unique_ptr<Sampler> build_sampler(std::size_t capacity, SampleSink &sink);
+
+private:
+    friend class WeatherPrinterConstructor;
+
+    PrinterBuilder(WeatherPrinterConstructor &owner, std::unique_ptr<WeatherPrinter> base)
+        : owner(owner), base(std::move(base)) {
+    }
+
+    WeatherPrinterConstructor &owner;
+    std::unique_ptr<WeatherPrinter> base;
+    std::vector<SensorHandle> sensors;
+};
+
+// Consecutive samples handed to a SampleSink. Row i was taken at times[i]
+// (nanoseconds since the system clock's epoch); column(s) holds sensor s's
+// values for those rows, as doubles. Everything points into the sampler's
+// ring and is only valid during the consume call.
+struct SampleBatch {
+    std::span<const WeatherPrinterConstructor::SensorHandle> sensors;
+    std::span<const std::int64_t> times;
+    const double *values;
+    std::size_t stride;
+
+    std::span<const double> column(std::size_t sensor) const {
+        return {values + sensor * stride, times.size()};
+    }
+};
+
+class SampleSink {
+public:
+    virtual void consume(const SampleBatch &batch) = 0;
+
+    virtual ~SampleSink() {}
+};
+
+// Polls a fixed set of sensors, all with arithmetic measure() results, into
+// a preallocated ring of `capacity` rows laid out as one column per sensor,
+// and hands the filled rows to a sink in batches. The producer side,
+// sample(), neither allocates nor formats; when the sink falls behind and
+// the ring is full, samples are dropped and counted rather than buffered.
+// sample() and flush() may run on different threads, one thread each;
+// start() runs both on background threads.
+class WeatherPrinterConstructor::Sampler {
+public:
+    Sampler(std::vector<SensorHandle> &&sensors, std::size_t capacity, SampleSink &sink);
+
+    Sampler(const Sampler &) = delete;
+    Sampler &operator=(const Sampler &) = delete;
+
+    ~Sampler();
+
+    // Takes one row. A sensor whose measure() throws records NaN. Returns
+    // false if the row was dropped because the ring is full.
+    bool sample();
+
+    // Passes everything sampled so far to the sink, in at most two batches
+    // when the pending rows wrap around the end of the ring, and returns the
+    // number of rows delivered.
+    std::size_t flush();
+
+    // Samples every `period` and flushes every `flush_interval` on two
+    // background threads until stop().
+    void start(std::chrono::nanoseconds period, std::chrono::milliseconds flush_interval);
+
+    // Stops the background threads and flushes what is left.
+    void stop();
+
+    std::size_t dropped() const {
+        return dropped_rows.load(std::memory_order_relaxed);
+    }
+
+private:
+    SensorStore store;
+    std::size_t capacity;
+    SampleSink &sink;
+    std::vector<std::int64_t> times;
+    std::vector<double> values;
+    std::atomic<std::size_t> head = 0;
+    std::atomic<std::size_t> tail = 0;
+    std::atomic<std::size_t> dropped_rows = 0;
+    std::mutex flushing;
+    std::atomic<bool> running = false;
+    std::thread sampler_thread;
+    std::thread flusher_thread;
+};
+
+// The "name: value" lines print_to would write, one pass per stream write.
+class TextSink final : public MeasurementSink {
+public:
+    explicit TextSink(std::ostream &stream) : stream(stream) {
+    }
+
+    void begin() override;
+
+    void integer(std::uint32_t id, std::string_view name, std::int64_t value) override;
+
+    void real(std::uint32_t id, std::string_view name, double value) override;
+
+    void text(std::uint32_t id, std::string_view name, std::string_view value) override;
+
+    void end() override;
+
+private:
+    std::ostream &stream;
+    std::string buffer;
+};
+
+// One JSON object per pass and line, keyed by sensor name:
+//
+//     {"temperature":23.5,"humidity":41,"wind":"NE"}
+//
+// Reals that are not finite are written as null.
+class JsonLinesSink final : public MeasurementSink {
+public:
+    explicit JsonLinesSink(std::ostream &stream) : stream(stream) {
+    }
+
+    void begin() override;
+
+    void integer(std::uint32_t id, std::string_view name, std::int64_t value) override;
+
+    void real(std::uint32_t id, std::string_view name, double value) override;
+
+    void text(std::uint32_t id, std::string_view name, std::string_view value) override;
+
+    void end() override;
+
+private:
+    void append_key(std::string_view name);
+
+    std::ostream &stream;
+    std::string buffer;
+};
+
+// Record format written by BinarySink, in native byte order. Each record is
+// a BinaryRecordHeader followed by `size` payload bytes, zero padded to the
+// next multiple of 8:
+//
+//     pass      a pass begins; payload is the int64 system clock time in ns
+//     name      first record of a sensor in this sink; payload is its name
+//     integer   payload is an int64
+//     real      payload is a double
+//     text      payload is the text, not terminated
+//
+// Every record after `pass` carries the sensor's registry id, and `name`
+// maps it to its name once, so a stream can be decoded without the registry.
+enum class BinaryKind : std::uint32_t {
+    pass,
+    name,
+    integer,
+    real,
+    text,
+};
+
+struct BinaryRecordHeader {
+    std::uint32_t sensor_id;
+    BinaryKind kind;
+    std::uint64_t size;
+};
+
+// One record of a binary stream. The payload points into the stream itself.
+struct BinaryRecord {
+    std::uint32_t sensor_id;
+    BinaryKind kind;
+    std::span<const std::byte> payload;
+
+    // The payload of a pass or integer record.
+    std::int64_t integer() const;
+
+    double real() const;
+
+    // The payload of a name or text record.
+    std::string_view text() const {
+        return {reinterpret_cast<const char *>(payload.data()), payload.size()};
+    }
+};
+
+// Walks the records of a binary stream in place. Iteration throws
+// std::invalid_argument at a truncated record.
+class BinaryRecords {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = BinaryRecord;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const BinaryRecord *;
+        using reference = const BinaryRecord &;
+
+        iterator() = default;
+
+        reference operator*() const {
+            return record;
+        }
+
+        pointer operator->() const {
+            return &record;
+        }
+
+        iterator &operator++();
+
+        iterator operator++(int) {
+            iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const iterator &other) const {
+            return rest.data() == other.rest.data();
+        }
+
+    private:
+        friend class BinaryRecords;
+
+        explicit iterator(std::span<const std::byte> rest);
+
+        std::span<const std::byte> rest;
+        BinaryRecord record{};
+    };
+
+    explicit BinaryRecords(std::span<const std::byte> bytes) : bytes(bytes) {
+    }
+
+    iterator begin() const {
+        return iterator(bytes);
+    }
+
+    iterator end() const {
+        return iterator(bytes.last(0));
+    }
+
+private:
+    std::span<const std::byte> bytes;
+};
+
+// Appends every pass to an in-memory byte stream in the format above.
+// Consumers read data() in place, e.g. through records(), and clear() what
+// they have taken; sensor names are still only sent once per sink.
+class BinarySink final : public MeasurementSink {
+public:
+    void begin() override;
+
+    void integer(std::uint32_t id, std::string_view name, std::int64_t value) override;
+
+    void real(std::uint32_t id, std::string_view name, double value) override;
+
+    void text(std::uint32_t id, std::string_view name, std::string_view value) override;
+
+    std::span<const std::byte> data() const {
+        return buffer;
+    }
+
+    BinaryRecords records() const {
+        return BinaryRecords(data());
+    }
+
+    void clear() {
+        buffer.clear();
+    }
+
+private:
+    void append(std::uint32_t id, BinaryKind kind, const void *payload, std::size_t size);
+
+    void announce(std::uint32_t id, std::string_view name);
+
+    std::vector<std::byte> buffer;
+    std::vector<bool> named;
+};
+
+// Sensor that memoizes S::measure() for TtlMs milliseconds. Every instance
+// created for the same registered name shares one S and one cached value,
+// so printers built from the same registry read the hardware at most once
+// per TTL between them. Readers of a fresh value only take a shared lock;
+// an expired value is refreshed by one reader while the others wait for it.
+//
+//     SensorRegistrator<CachedSensor<Thermometer, 500>> registrator("temperature");
+template<Sensor S, unsigned TtlMs = 1000>
+class CachedSensor {
+public:
+    using value_type = std::decay_t<decltype(std::declval<S &>().measure())>;
+
+    CachedSensor();
+
+    CachedSensor(named_sensor_tag, const std::string &sensor_name);
+
+    value_type measure();
+
+private:
+    struct Entry {
+        std::shared_mutex mutex;
+        S sensor;
+        std::optional<value_type> value;
+        std::chrono::steady_clock::time_point taken;
+    };
+
+    static std::shared_ptr<Entry> entry_for(const std::string &sensor_name);
+
+    std::shared_ptr<Entry> entry;
+};
+
+// Sensor that times S::measure() into the latency histogram of the name it
+// was registered under, which all instances of that name share. Registered
+// through LatencyInstrumentation:
+//
+//     SensorRegistrator<Thermometer, LatencyInstrumentation> registrator("temperature");
 template<Sensor S>
+class InstrumentedSensor {
+public:
+    using value_type = std::decay_t<decltype(std::declval<S &>().measure())>;
+
+    InstrumentedSensor();
+
+    InstrumentedSensor(named_sensor_tag, const std::string &sensor_name);
+
+    value_type measure();
+
+private:
+    S sensor;
+    std::shared_ptr<LatencyRecorder> recorder;
+};
+
+// Printer for a sensor set known at compile time. The sensors are members of
+// one std::tuple and print_to is unrolled over them, so there is neither a
+// registry lookup nor an indirect call per sensor:
+//
+//     SensorTuplePrinter<Thermometer, Hygrometer> printer({"temperature", "humidity"});
+template<Sensor... S>
+class SensorTuplePrinter final : public WeatherPrinter {
+public:
+    explicit SensorTuplePrinter(std::array<std::string, sizeof...(S)> names)
+        : SensorTuplePrinter(std::move(names), std::index_sequence_for<S...>()) {
+    }
+
+    void print_to(std::ostream &stream) override;
+
+private:
+    template<std::size_t... I>
+    SensorTuplePrinter(std::array<std::string, sizeof...(S)> &&names, std::index_sequence<I...>)
+        : names(std::move(names)), sensors(construct_sensor<S>(this->names[I])...) {
+    }
+
+    std::array<std::string, sizeof...(S)> names;
+    std::tuple<S...> sensors;
+    std::string buffer;
+};
+
+template<Sensor S, class Instrumentation = NoInstrumentation>
 class SensorRegistrator {
 public:
     explicit SensorRegistrator(std::string sensor_name);